@@ -7,6 +7,9 @@ REM ============================================================================
 
 setlocal enabledelayedexpansion
 
+REM Sectors stage 2 loads for the kernel (keep in sync with the Makefile)
+set KERNEL_SECTORS=192
+
 echo.
 echo ========================================
 echo  KontolOS Build System for Windows
@@ -75,7 +78,7 @@ if %ERRORLEVEL% NEQ 0 (
 echo [+] Stage 1 bootloader built
 
 REM Build Stage 2 bootloader
-nasm -f bin src\boot\stage2.asm -o build\stage2.bin
+nasm -f bin -DKERNEL_SECTORS=%KERNEL_SECTORS% src\boot\stage2.asm -o build\stage2.bin
 if %ERRORLEVEL% NEQ 0 (
     echo [!] Failed to build Stage 2 bootloader
     exit /b 1
@@ -98,6 +101,12 @@ if %ERRORLEVEL% NEQ 0 (
     exit /b 1
 )
 
+nasm -f elf32 src\kernel\switch.asm -o build\kernel\switch.o
+if %ERRORLEVEL% NEQ 0 (
+    echo [!] Failed to build switch.asm
+    exit /b 1
+)
+
 REM Build kernel C files
 for %%f in (src\kernel\*.c) do (
     set BASENAME=%%~nf
@@ -137,7 +146,7 @@ echo.
 echo [*] Linking kernel...
 
 REM Link kernel
-i686-elf-ld -m elf_i386 -T src\linker.ld -nostdlib build\kernel\kernel_entry.o build\kernel\isr.o build\kernel\kernel.o build\kernel\idt.o build\kernel\memory.o build\kernel\shell.o build\drivers\vga.o build\drivers\keyboard.o build\drivers\timer.o build\lib\string.o -o build\kernel.elf
+i686-elf-ld -m elf_i386 -T src\linker.ld -nostdlib build\kernel\kernel_entry.o build\kernel\isr.o build\kernel\switch.o build\kernel\kernel.o build\kernel\idt.o build\kernel\memory.o build\kernel\shell.o build\kernel\pmm.o build\kernel\slab.o build\kernel\bench.o build\kernel\cpu.o build\kernel\paging.o build\kernel\memops.o build\kernel\arena.o build\kernel\mempool.o build\kernel\kbuf.o build\drivers\vga.o build\drivers\keyboard.o build\drivers\timer.o build\drivers\serial.o build\drivers\fbcon.o build\lib\string.o build\lib\printf.o build\lib\checksum.o -o build\kernel.elf
 if %ERRORLEVEL% NEQ 0 (
     echo [!] Failed to link kernel
     exit /b 1
@@ -150,6 +159,14 @@ if %ERRORLEVEL% NEQ 0 (
     exit /b 1
 )
 
+REM Stage 2 loads only KERNEL_SECTORS sectors of the kernel
+set /a KERNEL_MAX=%KERNEL_SECTORS% * 512
+for %%A in (build\kernel.bin) do set KERNEL_SIZE=%%~zA
+if !KERNEL_SIZE! GTR !KERNEL_MAX! (
+    echo [!] kernel.bin is !KERNEL_SIZE! bytes, stage 2 loads !KERNEL_MAX!
+    exit /b 1
+)
+
 echo [+] Kernel linked
 
 echo.
@@ -11,10 +11,10 @@ echo [*] Starting KontolOS in QEMU...
 
 REM Try common QEMU locations
 if exist "C:\Program Files\qemu\qemu-system-i386.exe" (
-    "C:\Program Files\qemu\qemu-system-i386.exe" -fda build\kontolos.img -boot a
+    "C:\Program Files\qemu\qemu-system-i386.exe" -fda build\kontolos.img -boot a -vga std
 ) else if exist "C:\Program Files (x86)\qemu\qemu-system-i386.exe" (
-    "C:\Program Files (x86)\qemu\qemu-system-i386.exe" -fda build\kontolos.img -boot a
+    "C:\Program Files (x86)\qemu\qemu-system-i386.exe" -fda build\kontolos.img -boot a -vga std
 ) else (
     REM Try from PATH
-    qemu-system-i386 -fda build\kontolos.img -boot a
+    qemu-system-i386 -fda build\kontolos.img -boot a -vga std
 )
@@ -11,7 +11,31 @@
 KERNEL_LOAD_ADDR        equ 0x100000    ; 1MB mark
 KERNEL_TEMP_SEG         equ 0x2000      ; 0x20000
 KERNEL_TEMP_ADDR        equ 0x20000
-KERNEL_SECTORS          equ 48          ; ~24KB for kernel
+; Kernel load window in sectors, passed in by the build (-DKERNEL_SECTORS=)
+; so the kernel.bin size check uses the same value; 192 fills 0x20000-0x37FFF
+%ifndef KERNEL_SECTORS
+%error "KERNEL_SECTORS must be defined (see KERNEL_SECTORS in the Makefile)"
+%endif
+
+; Boot info block handed to the kernel (see src/kernel/bootinfo.h)
+BOOT_INFO_ADDR          equ 0x8000      ; Boot info header
+BOOT_INFO_MAGIC         equ 0x3149424B  ; "KBI1"
+BOOT_MMAP_ADDR          equ 0x8100      ; E820 entries (24 bytes each)
+BOOT_MMAP_MAX           equ 64
+E820_SMAP               equ 0x534D4150  ; "SMAP"
+BOOT_INFO_FB            equ 12          ; fb_addr, pitch, width, height, bpp
+BOOT_INFO_FONT          equ 32
+BOOT_FONT_ADDR          equ 0x9000      ; 8x16 ROM font (256 glyphs, 4KB)
+
+; VBE framebuffer mode for the kernel console (make VBE=0 keeps text mode)
+%ifndef VBE_ENABLE
+%define VBE_ENABLE      1
+%endif
+VBE_WIDTH               equ 1024
+VBE_HEIGHT              equ 768
+VBE_BPP                 equ 32
+VBE_INFO_BUF            equ 0x2000      ; 1000:2000, controller info (512 bytes)
+VBE_MODE_BUF            equ 0x2200      ; 1000:2200, mode info (256 bytes)
 
 ; ============================================================================
 ; Entry Point
@@ -36,6 +60,11 @@ stage2_start:
     mov si, msg_a20
     call print16
 
+    ; Collect the BIOS memory map
+    call detect_memory
+    mov si, msg_mmap
+    call print16
+
     ; Load kernel
     mov si, msg_loading
     call print16
@@ -52,6 +81,9 @@ stage2_start:
     mov si, msg_pmode
     call print16
 
+    ; Video mode last: BIOS text output stops working in graphics modes
+    call setup_video
+
     cli
     
     mov eax, cr0
@@ -72,6 +104,177 @@ enable_a20:
     out 0x92, al
     ret
 
+; ============================================================================
+; Detect memory via INT 15h, EAX=E820h
+; Fills the boot info block at BOOT_INFO_ADDR (0000:8000). If the BIOS
+; does not support E820 the entry count stays 0 and the kernel falls
+; back to a fixed layout.
+; ============================================================================
+detect_memory:
+    pushad
+    push es
+
+    xor ax, ax
+    mov es, ax
+    mov dword [es:BOOT_INFO_ADDR], BOOT_INFO_MAGIC
+    mov dword [es:BOOT_INFO_ADDR + 4], 0
+    mov dword [es:BOOT_INFO_ADDR + 8], BOOT_MMAP_ADDR
+
+    mov di, BOOT_MMAP_ADDR
+    xor ebx, ebx                ; Continuation value, 0 = start
+    xor bp, bp                  ; Entries stored
+
+.next:
+    mov eax, 0xE820
+    mov edx, E820_SMAP
+    mov ecx, 24
+    mov dword [es:di + 20], 1   ; Valid ACPI attrs if BIOS returns 20 bytes
+    int 0x15
+    jc .done                    ; Unsupported, or past the last entry
+    cmp eax, E820_SMAP
+    jne .done
+
+    ; Skip zero-length entries
+    mov ecx, [es:di + 8]
+    or ecx, [es:di + 12]
+    jz .skip
+
+    inc bp
+    add di, 24
+    cmp bp, BOOT_MMAP_MAX
+    jae .done
+
+.skip:
+    test ebx, ebx               ; EBX = 0 after the last entry
+    jnz .next
+
+.done:
+    mov [es:BOOT_INFO_ADDR + 4], bp
+
+    pop es
+    popad
+    ret
+
+; ============================================================================
+; Set up the display for the kernel
+; Copies the 8x16 ROM font to BOOT_FONT_ADDR, then walks the VBE mode
+; list for VBE_WIDTH x VBE_HEIGHT at 32 bpp (xRGB) with a linear
+; framebuffer and switches to it. The mode goes into the boot info
+; block; without a matching mode the screen stays in text mode and
+; fb_addr stays 0.
+; ============================================================================
+setup_video:
+    pushad
+    push es
+    push gs
+
+    xor ax, ax
+    mov es, ax
+    mov di, BOOT_INFO_ADDR + BOOT_INFO_FB
+    xor eax, eax
+    mov cx, 6                   ; fb_addr .. font
+    cld
+    rep stosd
+
+%if VBE_ENABLE
+    ; ROM font: INT 10h AX=1130h BH=06h returns it in ES:BP
+    push ds
+    mov ax, 0x1130
+    mov bh, 0x06
+    int 0x10
+    push es
+    pop ds
+    mov si, bp
+    xor ax, ax
+    mov es, ax
+    mov di, BOOT_FONT_ADDR
+    mov cx, 4096 / 4
+    rep movsd
+    pop ds
+    mov dword [es:BOOT_INFO_ADDR + BOOT_INFO_FONT], BOOT_FONT_ADDR
+
+    ; Controller info, asking for the VBE 2.0 layout
+    push ds
+    pop es
+    mov di, VBE_INFO_BUF
+    mov dword [di], 'VBE2'
+    mov ax, 0x4F00
+    int 0x10
+    cmp ax, 0x004F
+    jne .done
+    cmp dword [VBE_INFO_BUF], 'VESA'
+    jne .done
+
+    ; Mode list: far pointer at offset 14, terminated by 0xFFFF
+    mov si, [VBE_INFO_BUF + 14]
+    mov ax, [VBE_INFO_BUF + 16]
+    mov gs, ax
+
+.next_mode:
+    mov cx, [gs:si]
+    cmp cx, 0xFFFF
+    je .done
+    add si, 2
+
+    mov [vbe_mode], cx
+    push si
+    push gs
+    mov ax, 0x4F01
+    mov di, VBE_MODE_BUF
+    int 0x10
+    pop gs
+    pop si
+    cmp ax, 0x004F
+    jne .next_mode
+
+    ; Supported graphics mode with a linear framebuffer
+    mov ax, [VBE_MODE_BUF]      ; Mode attributes
+    and ax, 0x0091
+    cmp ax, 0x0091
+    jne .next_mode
+    cmp word [VBE_MODE_BUF + 0x12], VBE_WIDTH
+    jne .next_mode
+    cmp word [VBE_MODE_BUF + 0x14], VBE_HEIGHT
+    jne .next_mode
+    cmp byte [VBE_MODE_BUF + 0x19], VBE_BPP
+    jne .next_mode
+    cmp byte [VBE_MODE_BUF + 0x1B], 6       ; Direct colour
+    jne .next_mode
+    cmp byte [VBE_MODE_BUF + 0x20], 16      ; Red in bits 16-23
+    jne .next_mode
+    cmp byte [VBE_MODE_BUF + 0x24], 0       ; Blue in bits 0-7
+    jne .next_mode
+
+    ; Switch, bit 14 selecting the linear framebuffer
+    mov bx, [vbe_mode]
+    or bx, 0x4000
+    mov ax, 0x4F02
+    int 0x10
+    cmp ax, 0x004F
+    jne .done
+
+    xor ax, ax
+    mov es, ax
+    mov eax, [VBE_MODE_BUF + 0x28]          ; Physical base
+    mov [es:BOOT_INFO_ADDR + BOOT_INFO_FB], eax
+    movzx eax, word [VBE_MODE_BUF + 0x10]   ; Bytes per scanline
+    mov [es:BOOT_INFO_ADDR + BOOT_INFO_FB + 4], eax
+    movzx eax, word [VBE_MODE_BUF + 0x12]
+    mov [es:BOOT_INFO_ADDR + BOOT_INFO_FB + 8], eax
+    movzx eax, word [VBE_MODE_BUF + 0x14]
+    mov [es:BOOT_INFO_ADDR + BOOT_INFO_FB + 12], eax
+    movzx eax, byte [VBE_MODE_BUF + 0x19]
+    mov [es:BOOT_INFO_ADDR + BOOT_INFO_FB + 16], eax
+%endif
+
+.done:
+    pop gs
+    pop es
+    popad
+    ret
+
+vbe_mode: dw 0
+
 ; ============================================================================
 ; Load kernel using simple loop
 ; ============================================================================
@@ -222,6 +425,7 @@ print16:
 ; ============================================================================
 msg_stage2:  db 13,10,'[Stage 2] Started',13,10,0
 msg_a20:     db '[Stage 2] A20 OK',13,10,0
+msg_mmap:    db '[Stage 2] Memory map OK',13,10,0
 msg_loading: db '[Stage 2] Loading kernel...',13,10,0
 msg_loaded:  db '[Stage 2] Kernel loaded',13,10,0
 msg_gdt:     db '[Stage 2] GDT OK',13,10,0
@@ -278,6 +482,8 @@ pmode_entry:
     mov byte [0xB800B], 0x0A
 
     ; Jump to kernel using indirect jump (fixes ORG 0 relative addressing issue)
+    ; EBX carries the boot info pointer to kernel_main
+    mov ebx, BOOT_INFO_ADDR
     mov eax, KERNEL_LOAD_ADDR
     jmp eax
 
@@ -0,0 +1,561 @@
+/*
+ * KontolOS Framebuffer Console
+ *
+ * Draws the console into the VBE linear framebuffer the Stage 2
+ * bootloader set up (32 bpp, xRGB), with the 8x16 VGA ROM font it
+ * copied out. The text itself stays in vga.c as a grid of VGA cells;
+ * vga.c reports which cells changed, and fbcon_flush() redraws the
+ * bounding rectangle of those changes plus the cursor, once per write.
+ *
+ * Glyphs come from a cache of pre-rendered cells. Each slot holds one
+ * (character, attribute) pair expanded to 8x16 pixels, so drawing a
+ * cached glyph is a copy of 16 rows of 32 bytes with no per-pixel work.
+ * Slots are picked by hashing the cell; a console uses few colour
+ * combinations, so after the first screenful nearly every glyph is a
+ * hit. Runs of blank cells bypass the cache and are filled instead.
+ *
+ * A scroll only bumps a counter. The next flush moves the surviving
+ * pixel rows up with a single memmove, or skips it when the whole
+ * screen scrolled away, so a burst of output costs one move in total.
+ *
+ * Fills and glyph copies have a "rep movsd" and an SSE2 variant, picked
+ * at boot like memops. As in memops.c, the SSE2 loops run with
+ * interrupts disabled, a bounded amount of work at a time.
+ */
+
+#include "fbcon.h"
+#include "vga.h"
+#include "kernel.h"
+#include "memory.h"
+#include "paging.h"
+#include "cpu.h"
+
+/* Pixels per glyph */
+#define GLYPH_PIXELS        (FBCON_FONT_WIDTH * FBCON_FONT_HEIGHT)
+
+/* Glyph cache: 2^GLYPH_CACHE_BITS slots of one pre-rendered glyph each */
+#define GLYPH_CACHE_BITS    9
+#define GLYPH_CACHE_SLOTS   (1 << GLYPH_CACHE_BITS)
+#define GLYPH_NONE          0xFFFFFFFF
+
+/* Glyphs (4KB) and fill pixels copied per interrupts-off stretch */
+#define GLYPH_RUN           8
+#define FILL_CHUNK          1024
+
+/* Cursor: the bottom scanlines of the cell, as in text mode */
+#define CURSOR_LINES        2
+
+/* The 16 VGA text colours as xRGB */
+static const uint32_t palette[16] = {
+    0x000000, 0x0000AA, 0x00AA00, 0x00AAAA,
+    0xAA0000, 0xAA00AA, 0xAA5500, 0xAAAAAA,
+    0x555555, 0x5555FF, 0x55FF55, 0x55FFFF,
+    0xFF5555, 0xFF55FF, 0xFFFF55, 0xFFFFFF,
+};
+
+/* Framebuffer */
+static bool active;
+static uint8_t *fb;
+static size_t fb_pitch;
+static const uint8_t *font;
+static size_t cols;
+static size_t rows;
+
+/* Glyph cache: the cell each slot holds, and its pixels */
+static uint32_t glyph_tags[GLYPH_CACHE_SLOTS];
+static uint32_t glyph_cache[GLYPH_CACHE_SLOTS][GLYPH_PIXELS] __attribute__((aligned(16)));
+
+/* Changed cells since the last flush, empty when top >= bottom */
+static size_t dirty_top;
+static size_t dirty_bottom;
+static size_t dirty_left;
+static size_t dirty_right;
+
+/* Grid scrolls not yet applied to the pixels */
+static size_t scroll_pending;
+
+/* Where the cursor was last drawn */
+static bool cursor_drawn;
+static size_t cursor_y;
+static size_t cursor_x;
+
+static struct fbcon_stats stats;
+
+/*
+ * Plain variant
+ */
+static void fill_stosd(uint32_t *dst, uint32_t color, size_t count)
+{
+    __asm__ volatile("rep stosl" : "+D"(dst), "+c"(count) : "a"(color) : "memory");
+}
+
+static void glyphs_movsd(uint8_t *dst, const uint32_t *const *glyphs, size_t count, size_t pitch)
+{
+    for (size_t i = 0; i < count; i++, dst += FBCON_FONT_WIDTH * 4) {
+        const uint32_t *src = glyphs[i];
+        uint8_t *line = dst;
+
+        for (int y = 0; y < FBCON_FONT_HEIGHT; y++, line += pitch) {
+            void *out = line;
+            size_t n = FBCON_FONT_WIDTH;
+            __asm__ volatile("rep movsl" : "+D"(out), "+S"(src), "+c"(n) : : "memory");
+        }
+    }
+}
+
+/*
+ * SSE2: 64-byte fills, one glyph row in two 16-byte moves
+ */
+static void fill_sse2(uint32_t *dst, uint32_t color, size_t count)
+{
+    /* Align the destination to 16 bytes */
+    while (count > 0 && ((uintptr_t)dst & 15)) {
+        *dst++ = color;
+        count--;
+    }
+
+    while (count >= 16) {
+        size_t chunk = (count > FILL_CHUNK) ? FILL_CHUNK : (count & ~(size_t)15);
+        count -= chunk;
+
+        uint32_t flags = irq_save();
+        __asm__ volatile(
+            "movd %2, %%xmm0\n\t"
+            "pshufd $0, %%xmm0, %%xmm0\n\t"
+            "1:\n\t"
+            "movdqa %%xmm0, (%0)\n\t"
+            "movdqa %%xmm0, 16(%0)\n\t"
+            "movdqa %%xmm0, 32(%0)\n\t"
+            "movdqa %%xmm0, 48(%0)\n\t"
+            "add $64, %0\n\t"
+            "sub $16, %1\n\t"
+            "jnz 1b"
+            : "+r"(dst), "+r"(chunk) : "r"(color) : "memory", "cc");
+        irq_restore(flags);
+    }
+
+    while (count > 0) {
+        *dst++ = color;
+        count--;
+    }
+}
+
+/* At most GLYPH_RUN glyphs per call */
+static void glyphs_sse2(uint8_t *dst, const uint32_t *const *glyphs, size_t count, size_t pitch)
+{
+    uint32_t flags = irq_save();
+    for (size_t i = 0; i < count; i++, dst += FBCON_FONT_WIDTH * 4) {
+        const uint32_t *src = glyphs[i];
+        uint8_t *line = dst;
+        size_t y = FBCON_FONT_HEIGHT;
+
+        __asm__ volatile(
+            "1:\n\t"
+            "movdqa (%1), %%xmm0\n\t"
+            "movdqa 16(%1), %%xmm1\n\t"
+            "movdqu %%xmm0, (%0)\n\t"
+            "movdqu %%xmm1, 16(%0)\n\t"
+            "add $32, %1\n\t"
+            "add %3, %0\n\t"
+            "dec %2\n\t"
+            "jnz 1b"
+            : "+r"(line), "+r"(src), "+r"(y) : "r"(pitch) : "memory", "cc");
+    }
+    irq_restore(flags);
+}
+
+/* Variant table, in order of preference (best last) */
+static const struct fbcon_blit blits[] = {
+    { "movsd", 0,                fill_stosd, glyphs_movsd },
+    { "sse2",  CPU_FEATURE_SSE2, fill_sse2,  glyphs_sse2  },
+};
+
+#define NUM_BLITS   (int)(sizeof(blits) / sizeof(blits[0]))
+
+static const struct fbcon_blit *blit = &blits[0];
+
+/*
+ * Top-left pixel of a cell
+ */
+static inline uint8_t *cell_pixels(size_t row, size_t col)
+{
+    return fb + row * FBCON_FONT_HEIGHT * fb_pitch + col * FBCON_FONT_WIDTH * 4;
+}
+
+/*
+ * Cache slot for a cell (Fibonacci hash of character and attribute)
+ */
+static inline size_t glyph_slot(uint16_t cell)
+{
+    return (uint16_t)(cell * 40503u) >> (16 - GLYPH_CACHE_BITS);
+}
+
+/*
+ * Expand a cell's glyph into pixels
+ */
+static void glyph_render(uint32_t *pixels, uint16_t cell)
+{
+    const uint8_t *bits = &font[(cell & 0xFF) * FBCON_FONT_HEIGHT];
+    uint32_t fg = palette[(cell >> 8) & 0x0F];
+    uint32_t bg = palette[(cell >> 12) & 0x0F];
+
+    for (int y = 0; y < FBCON_FONT_HEIGHT; y++) {
+        for (int x = 0; x < FBCON_FONT_WIDTH; x++) {
+            *pixels++ = (bits[y] & (0x80 >> x)) ? fg : bg;
+        }
+    }
+}
+
+/*
+ * Blank cells are drawn as background fills
+ */
+static inline bool cell_is_blank(uint16_t cell)
+{
+    return (cell & 0xFF) == ' ' || (cell & 0xFF) == 0;
+}
+
+/*
+ * Fill count cells of one row with a colour
+ */
+static void fill_cells(size_t row, size_t col, size_t count, uint32_t color)
+{
+    uint8_t *line = cell_pixels(row, col);
+
+    for (int y = 0; y < FBCON_FONT_HEIGHT; y++, line += fb_pitch) {
+        blit->fill((uint32_t *)line, color, count * FBCON_FONT_WIDTH);
+    }
+}
+
+/*
+ * Draw count cells of one row from the grid
+ *
+ * Cached glyphs are queued and copied GLYPH_RUN at a time. A miss
+ * renders into a slot that a queued glyph may still point at, so the
+ * queue is drawn first.
+ */
+static void draw_cells(const uint16_t *cells, size_t row, size_t col, size_t count)
+{
+    const uint16_t *cell = &cells[row * cols + col];
+    const uint32_t *queue[GLYPH_RUN];
+    size_t queued = 0;
+    size_t queue_col = col;
+
+    for (size_t i = 0; i < count; ) {
+        uint16_t c = cell[i];
+
+        if (cell_is_blank(c)) {
+            size_t run = 1;
+            while (i + run < count && cell_is_blank(cell[i + run]) &&
+                   (cell[i + run] >> 12) == (c >> 12)) {
+                run++;
+            }
+            if (queued > 0) {
+                blit->glyphs(cell_pixels(row, queue_col), queue, queued, fb_pitch);
+                queued = 0;
+            }
+            fill_cells(row, col + i, run, palette[(c >> 12) & 0x0F]);
+            i += run;
+            continue;
+        }
+
+        size_t slot = glyph_slot(c);
+        if (glyph_tags[slot] != c) {
+            if (queued > 0) {
+                blit->glyphs(cell_pixels(row, queue_col), queue, queued, fb_pitch);
+                queued = 0;
+            }
+            glyph_render(glyph_cache[slot], c);
+            glyph_tags[slot] = c;
+            stats.glyph_misses++;
+        } else {
+            stats.glyph_hits++;
+        }
+
+        if (queued == 0) {
+            queue_col = col + i;
+        }
+        queue[queued++] = glyph_cache[slot];
+        i++;
+
+        if (queued == GLYPH_RUN) {
+            blit->glyphs(cell_pixels(row, queue_col), queue, queued, fb_pitch);
+            queued = 0;
+        }
+    }
+
+    if (queued > 0) {
+        blit->glyphs(cell_pixels(row, queue_col), queue, queued, fb_pitch);
+    }
+    stats.cells += count;
+}
+
+/*
+ * Draw the cursor over a cell, in the cell's foreground colour
+ */
+static void draw_cursor(const uint16_t *cells, size_t row, size_t col)
+{
+    uint32_t color = palette[(cells[row * cols + col] >> 8) & 0x0F];
+    uint8_t *line = cell_pixels(row, col) + (FBCON_FONT_HEIGHT - CURSOR_LINES) * fb_pitch;
+
+    for (int y = 0; y < CURSOR_LINES; y++, line += fb_pitch) {
+        blit->fill((uint32_t *)line, color, FBCON_FONT_WIDTH);
+    }
+}
+
+/*
+ * Initialize the framebuffer console
+ */
+bool fbcon_init(struct boot_info *boot_info)
+{
+    active = false;
+
+    if (boot_info == NULL || boot_info->magic != BOOT_INFO_MAGIC ||
+        boot_info->fb_addr == 0 || boot_info->fb_bpp != 32 || boot_info->font == NULL) {
+        return false;
+    }
+
+    /* paging_init identity-maps the framebuffer; it must miss the heap */
+    uintptr_t base = boot_info->fb_addr;
+    size_t size = boot_info->fb_pitch * boot_info->fb_height;
+    if (base + size > HEAP_VIRT_BASE && base < HEAP_VIRT_BASE + HEAP_VIRT_SIZE) {
+        return false;
+    }
+
+    /* vga.c keeps at least an 80x25 grid, at most VGA_MAX_COLS x VGA_MAX_ROWS */
+    cols = boot_info->fb_width / FBCON_FONT_WIDTH;
+    rows = boot_info->fb_height / FBCON_FONT_HEIGHT;
+    if (cols < 80 || rows < 25) {
+        return false;
+    }
+    if (cols > VGA_MAX_COLS) {
+        cols = VGA_MAX_COLS;
+    }
+    if (rows > VGA_MAX_ROWS) {
+        rows = VGA_MAX_ROWS;
+    }
+
+    fb = (uint8_t *)base;
+    fb_pitch = boot_info->fb_pitch;
+    font = boot_info->font;
+
+    for (int i = 0; i < NUM_BLITS; i++) {
+        if (cpu_has(blits[i].features)) {
+            blit = &blits[i];
+        }
+    }
+
+    for (int i = 0; i < GLYPH_CACHE_SLOTS; i++) {
+        glyph_tags[i] = GLYPH_NONE;
+    }
+
+    memset(&stats, 0, sizeof(stats));
+    stats.width = boot_info->fb_width;
+    stats.height = boot_info->fb_height;
+    stats.cols = cols;
+    stats.rows = rows;
+
+    dirty_top = rows;
+    dirty_bottom = 0;
+    dirty_left = cols;
+    dirty_right = 0;
+    scroll_pending = 0;
+    cursor_drawn = false;
+
+    /* Start black; the margins right of and below the grid stay so */
+    for (size_t y = 0; y < boot_info->fb_height; y++) {
+        blit->fill((uint32_t *)(fb + y * fb_pitch), 0, boot_info->fb_width);
+    }
+
+    active = true;
+    return true;
+}
+
+/*
+ * Is the framebuffer console in use?
+ */
+bool fbcon_active(void)
+{
+    return active;
+}
+
+/*
+ * Console size
+ */
+size_t fbcon_get_cols(void)
+{
+    return active ? cols : 0;
+}
+
+size_t fbcon_get_rows(void)
+{
+    return active ? rows : 0;
+}
+
+/*
+ * Mark count cells from row, col on as changed
+ */
+void fbcon_touch(size_t row, size_t col, size_t count)
+{
+    if (!active || count == 0 || row >= rows || col >= cols) {
+        return;
+    }
+
+    size_t last = row + (col + count - 1) / cols;
+    if (last >= rows) {
+        last = rows - 1;
+    }
+
+    /* Spilling onto the next row makes the rectangle full width */
+    size_t left = col;
+    size_t right = col + count;
+    if (last > row) {
+        left = 0;
+        right = cols;
+    }
+
+    if (row < dirty_top) {
+        dirty_top = row;
+    }
+    if (last + 1 > dirty_bottom) {
+        dirty_bottom = last + 1;
+    }
+    if (left < dirty_left) {
+        dirty_left = left;
+    }
+    if (right > dirty_right) {
+        dirty_right = right;
+    }
+}
+
+/*
+ * Mark every cell as changed
+ */
+void fbcon_touch_all(void)
+{
+    fbcon_touch(0, 0, cols * rows);
+}
+
+/*
+ * The grid moved up one row: defer the pixel move to the next flush
+ */
+void fbcon_scroll(void)
+{
+    if (!active) {
+        return;
+    }
+
+    scroll_pending++;
+
+    if (dirty_top < dirty_bottom) {
+        if (dirty_top > 0) {
+            dirty_top--;
+        }
+        dirty_bottom--;
+    }
+
+    if (cursor_drawn) {
+        if (cursor_y > 0) {
+            cursor_y--;
+        } else {
+            cursor_drawn = false;   /* Scrolled off the top */
+        }
+    }
+}
+
+/*
+ * Draw everything changed since the last flush, then the cursor
+ */
+void fbcon_flush(const uint16_t *cells, size_t cursor_row, size_t cursor_col, bool cursor)
+{
+    if (!active) {
+        return;
+    }
+
+    cursor = cursor && cursor_row < rows && cursor_col < cols;
+    bool cursor_moved = cursor != cursor_drawn ||
+                        (cursor && (cursor_row != cursor_y || cursor_col != cursor_x));
+    if (dirty_top >= dirty_bottom && scroll_pending == 0 && !cursor_moved) {
+        return;
+    }
+
+    uint64_t start = rdtsc();
+
+    if (scroll_pending >= rows) {
+        fbcon_touch_all();
+    } else if (scroll_pending > 0) {
+        size_t line_bytes = FBCON_FONT_HEIGHT * fb_pitch;
+        memmove(fb, fb + scroll_pending * line_bytes, (rows - scroll_pending) * line_bytes);
+        stats.scroll_copies++;
+    }
+    scroll_pending = 0;
+
+    /* Take the old cursor off, unless its cell is redrawn anyway */
+    if (cursor_drawn && (cursor_y < dirty_top || cursor_y >= dirty_bottom ||
+                         cursor_x < dirty_left || cursor_x >= dirty_right)) {
+        draw_cells(cells, cursor_y, cursor_x, 1);
+    }
+
+    for (size_t y = dirty_top; y < dirty_bottom; y++) {
+        draw_cells(cells, y, dirty_left, dirty_right - dirty_left);
+    }
+    dirty_top = rows;
+    dirty_bottom = 0;
+    dirty_left = cols;
+    dirty_right = 0;
+
+    cursor_drawn = cursor;
+    if (cursor) {
+        draw_cursor(cells, cursor_row, cursor_col);
+        cursor_y = cursor_row;
+        cursor_x = cursor_col;
+    }
+
+    uint32_t cycles = (uint32_t)(rdtsc() - start);
+    stats.frames++;
+    stats.last_cycles = cycles;
+    stats.total_cycles += cycles;
+    if (cycles > stats.max_cycles) {
+        stats.max_cycles = cycles;
+    }
+}
+
+/*
+ * Get a blit variant by index (NULL past the end)
+ */
+const struct fbcon_blit *fbcon_get_blit(int index)
+{
+    if (index < 0 || index >= NUM_BLITS) {
+        return NULL;
+    }
+    return &blits[index];
+}
+
+/*
+ * Get the variant in use
+ */
+const struct fbcon_blit *fbcon_get_active_blit(void)
+{
+    return blit;
+}
+
+/*
+ * Switch variants (the CPU must support it)
+ */
+void fbcon_set_blit(const struct fbcon_blit *variant)
+{
+    if (variant != NULL && cpu_has(variant->features)) {
+        blit = variant;
+    }
+}
+
+/*
+ * Get statistics
+ */
+bool fbcon_get_stats(struct fbcon_stats *out)
+{
+    if (!active || out == NULL) {
+        return false;
+    }
+    *out = stats;
+    return true;
+}
@@ -0,0 +1,67 @@
+/*
+ * KontolOS Framebuffer Console Header
+ */
+
+#ifndef FBCON_H
+#define FBCON_H
+
+#include "../include/types.h"
+#include "../kernel/bootinfo.h"
+
+/* Character cell size (the 8x16 VGA ROM font) */
+#define FBCON_FONT_WIDTH    8
+#define FBCON_FONT_HEIGHT   16
+
+/* One implementation of the pixel loops */
+struct fbcon_blit {
+    const char *name;
+    uint32_t features;      /* Required CPU features (CPU_FEATURE_*) */
+    void (*fill)(uint32_t *dst, uint32_t color, size_t count);
+    void (*glyphs)(uint8_t *dst, const uint32_t *const *glyphs, size_t count, size_t pitch);
+};
+
+/* Counters since fbcon_init */
+struct fbcon_stats {
+    uint32_t width;         /* Mode, in pixels */
+    uint32_t height;
+    size_t cols;            /* Console size, in cells */
+    size_t rows;
+    uint32_t frames;        /* Flushes that drew something */
+    uint32_t cells;         /* Cells drawn */
+    uint32_t glyph_hits;
+    uint32_t glyph_misses;
+    uint32_t scroll_copies; /* Scrolls done by moving pixels */
+    uint32_t last_cycles;   /* Frame times, TSC cycles */
+    uint32_t max_cycles;
+    uint64_t total_cycles;
+};
+
+/* Take over the framebuffer stage 2 set up, if any (needs memops_init
+ * first); returns false in text mode */
+bool fbcon_init(struct boot_info *boot_info);
+bool fbcon_active(void);
+
+/* Console size in cells */
+size_t fbcon_get_cols(void);
+size_t fbcon_get_rows(void);
+
+/*
+ * Drawing follows a cell grid owned by the caller (cols x rows cells,
+ * VGA character/attribute format). Mark changed cells (count cells in
+ * reading order from row, col), note that the grid moved up a row, and
+ * flush to draw everything changed since the last flush.
+ */
+void fbcon_touch(size_t row, size_t col, size_t count);
+void fbcon_touch_all(void);
+void fbcon_scroll(void);
+void fbcon_flush(const uint16_t *cells, size_t cursor_row, size_t cursor_col, bool cursor);
+
+/* Blit variant access (NULL past the end) */
+const struct fbcon_blit *fbcon_get_blit(int index);
+const struct fbcon_blit *fbcon_get_active_blit(void);
+void fbcon_set_blit(const struct fbcon_blit *blit);
+
+/* Statistics, false when not active */
+bool fbcon_get_stats(struct fbcon_stats *stats);
+
+#endif /* FBCON_H */
@@ -11,18 +11,34 @@
 #define KEYBOARD_DATA_PORT      0x60
 #define KEYBOARD_STATUS_PORT    0x64
 
-/* Keyboard buffer */
+/* Keyboard buffer (filled by the interrupt handler) */
 #define KEYBOARD_BUFFER_SIZE    256
 static char keyboard_buffer[KEYBOARD_BUFFER_SIZE];
 static volatile size_t buffer_start = 0;
 static volatile size_t buffer_end = 0;
 
+/*
+ * Per-console input. Keys are moved here from the keyboard buffer in
+ * thread context, to whichever console is in front at that moment;
+ * console keys (switching, scrollback) are acted on instead.
+ */
+#define CONSOLE_INPUT_SIZE      128
+static char console_input[VGA_NUM_CONSOLES][CONSOLE_INPUT_SIZE];
+static size_t input_start[VGA_NUM_CONSOLES];
+static size_t input_end[VGA_NUM_CONSOLES];
+
+/* Runs other consoles' readers while one waits for input */
+static keyboard_console_fn console_handler = NULL;
+
 /* Shift/Ctrl/Alt state */
 static volatile bool shift_pressed = false;
 static volatile bool ctrl_pressed = false;
 static volatile bool alt_pressed = false;
 static volatile bool capslock_on = false;
 
+/* Set after an 0xE0 prefix: the next scancode is an extended key */
+static volatile bool extended_key = false;
+
 /* US QWERTY keyboard scancode to ASCII mapping (lowercase) */
 static const char scancode_to_ascii[] = {
     0,    27,  '1', '2', '3', '4', '5', '6', '7', '8', '9', '0', '-', '=', '\b',
@@ -62,6 +78,11 @@ static const char scancode_to_ascii_shift[] = {
 #define SCANCODE_F9             0x43
 #define SCANCODE_F10            0x44
 
+/* Extended scancodes (after the 0xE0 prefix) */
+#define SCANCODE_EXTENDED       0xE0
+#define SCANCODE_EXT_PAGE_UP    0x49
+#define SCANCODE_EXT_PAGE_DOWN  0x51
+
 /* Key release flag (bit 7 set) */
 #define KEY_RELEASE_FLAG        0x80
 
@@ -87,10 +108,31 @@ static void keyboard_handler(struct interrupt_frame *frame)
     /* Read scancode from keyboard controller */
     uint8_t scancode = inb(KEYBOARD_DATA_PORT);
 
+    if (scancode == SCANCODE_EXTENDED) {
+        extended_key = true;
+        return;
+    }
+
     /* Check if key release */
     bool released = (scancode & KEY_RELEASE_FLAG) != 0;
     scancode &= ~KEY_RELEASE_FLAG;
 
+    if (extended_key) {
+        extended_key = false;
+
+        /* Right Ctrl/Alt act like the left ones; other keys are presses only */
+        if (scancode == SCANCODE_LCTRL) {
+            ctrl_pressed = !released;
+        } else if (scancode == SCANCODE_LALT) {
+            alt_pressed = !released;
+        } else if (!released && scancode == SCANCODE_EXT_PAGE_UP) {
+            buffer_put(KEY_PAGE_UP);
+        } else if (!released && scancode == SCANCODE_EXT_PAGE_DOWN) {
+            buffer_put(KEY_PAGE_DOWN);
+        }
+        return;
+    }
+
     /* Handle modifier keys */
     switch (scancode) {
         case SCANCODE_LSHIFT:
@@ -118,6 +160,12 @@ static void keyboard_handler(struct interrupt_frame *frame)
         return;
     }
 
+    /* Alt+F1..F4: switch virtual console */
+    if (alt_pressed && scancode >= SCANCODE_F1 && scancode < SCANCODE_F1 + VGA_NUM_CONSOLES) {
+        buffer_put(KEY_CONSOLE(scancode - SCANCODE_F1));
+        return;
+    }
+
     /* Convert scancode to ASCII */
     if (scancode < sizeof(scancode_to_ascii)) {
         char c;
@@ -158,52 +206,110 @@ static void keyboard_handler(struct interrupt_frame *frame)
  */
 void keyboard_init(void)
 {
-    /* Clear buffer */
+    /* Clear buffers */
     buffer_start = 0;
     buffer_end = 0;
+    for (int i = 0; i < VGA_NUM_CONSOLES; i++) {
+        input_start[i] = 0;
+        input_end[i] = 0;
+    }
 
     /* Register keyboard interrupt handler (IRQ1) */
     irq_register_handler(1, keyboard_handler);
 }
 
 /*
- * Check if a key is available in the buffer
+ * Move keys from the keyboard buffer to the front console, handling
+ * console keys on the way
  */
-bool keyboard_has_key(void)
+static void keyboard_dispatch(void)
 {
-    return buffer_start != buffer_end;
+    while (buffer_start != buffer_end) {
+        char c = keyboard_buffer[buffer_start];
+        buffer_start = (buffer_start + 1) % KEYBOARD_BUFFER_SIZE;
+
+        uint8_t key = (uint8_t)c;
+        if (c == KEY_PAGE_UP) {
+            vga_scroll_view(VGA_PAGE_LINES);
+        } else if (c == KEY_PAGE_DOWN) {
+            vga_scroll_view(-VGA_PAGE_LINES);
+        } else if (key >= (uint8_t)KEY_CONSOLE(0) && key < (uint8_t)KEY_CONSOLE(VGA_NUM_CONSOLES)) {
+            vga_switch_console(key - (uint8_t)KEY_CONSOLE(0));
+        } else {
+            int console = vga_get_foreground();
+            size_t next = (input_end[console] + 1) % CONSOLE_INPUT_SIZE;
+            if (next != input_start[console]) {
+                console_input[console][input_end[console]] = c;
+                input_end[console] = next;
+            }
+        }
+    }
 }
 
 /*
- * Get a key from the buffer (blocking)
+ * Take the next key queued for a console (0 if none)
  */
-char keyboard_getchar(void)
+static char input_get(int console)
 {
-    /* Wait for a key */
-    while (!keyboard_has_key()) {
-        halt();
+    if (input_start[console] == input_end[console]) {
+        return 0;
     }
 
-    /* Get character from buffer */
-    char c = keyboard_buffer[buffer_start];
-    buffer_start = (buffer_start + 1) % KEYBOARD_BUFFER_SIZE;
-
+    char c = console_input[console][input_start[console]];
+    input_start[console] = (input_start[console] + 1) % CONSOLE_INPUT_SIZE;
     return c;
 }
 
 /*
- * Get a key from the buffer (non-blocking)
+ * Set the function a blocked reader waits in, so that other consoles'
+ * readers can run meanwhile
  */
-char keyboard_getchar_nonblock(void)
+void keyboard_set_console_handler(keyboard_console_fn handler)
 {
-    if (!keyboard_has_key()) {
-        return 0;
-    }
+    console_handler = handler;
+}
 
-    char c = keyboard_buffer[buffer_start];
-    buffer_start = (buffer_start + 1) % KEYBOARD_BUFFER_SIZE;
+/*
+ * Check if a key is available for the output console
+ */
+bool keyboard_has_key(void)
+{
+    int console = vga_get_console();
 
-    return c;
+    keyboard_dispatch();
+    return input_start[console] != input_end[console];
+}
+
+/*
+ * Get a key for the output console (blocking)
+ */
+char keyboard_getchar(void)
+{
+    int console = vga_get_console();
+
+    /* Wait for a key */
+    for (;;) {
+        keyboard_dispatch();
+        char c = input_get(console);
+        if (c != 0) {
+            return c;
+        }
+
+        if (console_handler != NULL) {
+            console_handler(console);
+        } else {
+            kernel_idle();
+        }
+    }
+}
+
+/*
+ * Get a key for the output console (non-blocking, 0 if none)
+ */
+char keyboard_getchar_nonblock(void)
+{
+    keyboard_dispatch();
+    return input_get(vga_get_console());
 }
 
 /*
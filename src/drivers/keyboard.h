@@ -7,9 +7,24 @@
 
 #include "../include/types.h"
 
+/* Console keys, handled inside the driver (outside the ASCII range) */
+#define KEY_PAGE_UP     ((char)0x80)
+#define KEY_PAGE_DOWN   ((char)0x81)
+#define KEY_CONSOLE(n)  ((char)(0x82 + (n)))    /* Alt+F1.. */
+
+/*
+ * Input is per virtual console: readers get the keys typed while their
+ * console (vga_get_console) was in front. A blocked reader calls the
+ * handler with its console's index instead of idling; the handler lets
+ * other consoles' readers run and returns once the console has input.
+ */
+typedef void (*keyboard_console_fn)(int console);
+
 /* Initialize keyboard driver */
 void keyboard_init(void);
 
+void keyboard_set_console_handler(keyboard_console_fn handler);
+
 /* Check if a key is available */
 bool keyboard_has_key(void);
 
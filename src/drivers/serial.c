@@ -0,0 +1,81 @@
+/*
+ * KontolOS Serial Port Driver (16550 UART, polled output)
+ */
+
+#include "serial.h"
+#include "kernel.h"
+
+/* UART registers, relative to the port base */
+#define UART_DATA           0   /* Data / divisor low byte (DLAB=1) */
+#define UART_INT_ENABLE     1   /* Interrupt enable / divisor high byte */
+#define UART_FIFO_CTRL      2
+#define UART_LINE_CTRL      3
+#define UART_MODEM_CTRL     4
+#define UART_LINE_STATUS    5
+
+#define LCR_8N1             0x03
+#define LCR_DLAB            0x80
+#define LSR_THR_EMPTY       0x20
+#define MCR_LOOPBACK        0x10
+
+/* 115200 / 38400 */
+#define SERIAL_DIVISOR      3
+
+static bool serial_ok = false;
+
+/*
+ * Initialize COM1
+ */
+bool serial_init(void)
+{
+    uint16_t port = SERIAL_COM1;
+
+    outb(port + UART_INT_ENABLE, 0x00);         /* Polled, no interrupts */
+    outb(port + UART_LINE_CTRL, LCR_DLAB);
+    outb(port + UART_DATA, SERIAL_DIVISOR & 0xFF);
+    outb(port + UART_INT_ENABLE, SERIAL_DIVISOR >> 8);
+    outb(port + UART_LINE_CTRL, LCR_8N1);
+    outb(port + UART_FIFO_CTRL, 0xC7);          /* Enable and clear FIFOs */
+
+    /* Loopback self-test: a missing UART won't echo the byte */
+    outb(port + UART_MODEM_CTRL, MCR_LOOPBACK | 0x0B);
+    outb(port + UART_DATA, 0xAE);
+    serial_ok = (inb(port + UART_DATA) == 0xAE);
+
+    /* Normal operation: DTR, RTS, OUT2 */
+    outb(port + UART_MODEM_CTRL, 0x0B);
+    return serial_ok;
+}
+
+/*
+ * Send one character (LF becomes CR LF)
+ */
+void serial_putchar(char c)
+{
+    if (!serial_ok) {
+        return;
+    }
+
+    if (c == '\n') {
+        serial_putchar('\r');
+    }
+    while (!(inb(SERIAL_COM1 + UART_LINE_STATUS) & LSR_THR_EMPTY)) {
+        /* Wait for the transmitter */
+    }
+    outb(SERIAL_COM1 + UART_DATA, (uint8_t)c);
+}
+
+/*
+ * Send len characters
+ */
+void serial_write(const char *data, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        serial_putchar(data[i]);
+    }
+}
+
+bool serial_present(void)
+{
+    return serial_ok;
+}
@@ -0,0 +1,22 @@
+/*
+ * KontolOS Serial Port Driver Header
+ */
+
+#ifndef SERIAL_H
+#define SERIAL_H
+
+#include "../include/types.h"
+
+/* COM1 I/O base */
+#define SERIAL_COM1     0x3F8
+
+/* Initialize COM1 (38400 baud, 8N1); returns false if no UART answers */
+bool serial_init(void);
+
+/* Output (no-ops when there is no serial port) */
+void serial_putchar(char c);
+void serial_write(const char *data, size_t len);
+
+bool serial_present(void);
+
+#endif /* SERIAL_H */
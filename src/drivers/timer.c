@@ -16,9 +16,13 @@
 /* PIT frequency */
 #define PIT_BASE_FREQUENCY  1193182
 
+/* Ticks used to calibrate the TSC */
+#define TSC_CALIBRATE_TICKS 10
+
 /* Timer tick counter (using 32-bit to avoid 64-bit division which needs libgcc) */
 static volatile uint32_t timer_ticks = 0;
 static uint32_t timer_frequency = 0;
+static uint32_t tsc_khz = 0;
 
 /*
  * Timer interrupt handler (IRQ0)
@@ -67,6 +71,28 @@ uint32_t timer_get_uptime(void)
     return timer_ticks / timer_frequency;
 }
 
+/*
+ * Get the TSC frequency in kHz
+ */
+uint32_t timer_get_tsc_khz(void)
+{
+    if (tsc_khz == 0 && timer_frequency != 0) {
+        /* Start on a tick boundary */
+        uint32_t start_tick = timer_ticks;
+        while (timer_ticks == start_tick) {
+            halt();
+        }
+
+        uint64_t start = rdtsc();
+        timer_sleep_ticks(TSC_CALIBRATE_TICKS);
+        uint32_t per_tick = (uint32_t)(rdtsc() - start) / TSC_CALIBRATE_TICKS;
+
+        tsc_khz = per_tick / 1000 * timer_frequency;
+    }
+
+    return tsc_khz;
+}
+
 /*
  * Sleep for a number of ticks
  */
@@ -74,7 +100,7 @@ void timer_sleep_ticks(uint32_t ticks)
 {
     uint32_t end = timer_ticks + ticks;
     while (timer_ticks < end) {
-        halt();
+        kernel_idle();
     }
 }
 
@@ -16,6 +16,9 @@ uint32_t timer_get_ticks(void);
 /* Get uptime in seconds */
 uint32_t timer_get_uptime(void);
 
+/* TSC frequency in kHz (calibrated against the PIT on first use) */
+uint32_t timer_get_tsc_khz(void);
+
 /* Sleep functions */
 void timer_sleep_ticks(uint32_t ticks);
 void timer_sleep_ms(uint32_t ms);
@@ -1,30 +1,113 @@
 /*
  * KontolOS VGA Text Mode Driver
+ *
+ * The screen is a 80x25 view into the 32KB text window at 0xB8000.
+ * Scrolling moves the view down one row by reprogramming the CRTC
+ * start address instead of copying the screen; only when the view
+ * reaches the end of the live area are the visible rows copied back to
+ * the start, once every ~155 lines.
+ *
+ * The last screenful of the window is kept for browsing history. Rows
+ * that scroll off the top go into a ring of compact line records:
+ *
+ *   [chars] [runs] [fill attr] chars... (count, attr) x runs
+ *
+ * Trailing blanks in the fill attribute are dropped and attributes are
+ * run-length encoded, so a typical line costs well under 100 bytes.
+ * Paging back renders the selected lines into the history screen and
+ * points the CRTC there; the live screen is left untouched, and any new
+ * output switches back to it.
+ *
+ * Each virtual console has its own screen, cursor, colour and history.
+ * Output goes to the selected console (vga_set_console). The console in
+ * front draws straight into VGA memory; the others draw into their RAM
+ * back buffers, so background output never touches the hardware.
+ * Switching saves the front screen to its back buffer and copies the
+ * new console's back buffer to VGA memory in one go.
+ *
+ * When stage 2 set up a VBE framebuffer, the screens grow to whatever
+ * fbcon provides and all of them, the front one included, stay in
+ * their back buffers. Changed cells are reported to fbcon, which draws
+ * them at the points where text mode would move the hardware cursor;
+ * scrolling shifts the buffer instead of moving the CRTC start, and the
+ * history view is rendered into a RAM screen of its own.
  */
 
 #include "vga.h"
 #include "kernel.h"
+#include "string.h"
+#include "memory.h"
+#include "fbcon.h"
 
 /* VGA text mode buffer address */
 #define VGA_BUFFER  0xB8000
 
-/* Screen dimensions */
+/* Screen dimensions in text mode */
 #define VGA_WIDTH   80
 #define VGA_HEIGHT  25
 
+/* Largest screen (framebuffer console) */
+#define VGA_MAX_CELLS   (VGA_MAX_COLS * VGA_MAX_ROWS)
+
+/* Text window: 32KB of 2-byte cells, the last screen reserved for history */
+#define VGA_WINDOW_CELLS    16384
+#define VGA_SCREEN_CELLS    (VGA_WIDTH * VGA_HEIGHT)
+#define VGA_LIVE_CELLS      (VGA_WINDOW_CELLS - VGA_SCREEN_CELLS)
+#define VGA_HISTORY_SCREEN  ((uint16_t *)VGA_BUFFER + VGA_LIVE_CELLS)
+
+/* Line record header: chars, runs, fill attribute */
+#define SB_HEADER_SIZE      3
+#define SB_MAX_RECORD       (SB_HEADER_SIZE + VGA_MAX_COLS * 3)
+
+/* History bytes reserved per line (records average well below this) */
+#define SB_BYTES_PER_LINE   64
+
 /* VGA I/O ports */
 #define VGA_CTRL_PORT   0x3D4
 #define VGA_DATA_PORT   0x3D5
 
-/* Current cursor position */
-static size_t vga_row = 0;
-static size_t vga_col = 0;
-
-/* Current color attribute */
-static uint8_t vga_color = 0x0F;  /* White on black */
-
-/* Pointer to VGA buffer */
-static uint16_t *vga_buffer = (uint16_t *)VGA_BUFFER;
+/* CRTC registers */
+#define CRTC_START_HIGH     0x0C
+#define CRTC_START_LOW      0x0D
+#define CRTC_CURSOR_HIGH    0x0E
+#define CRTC_CURSOR_LOW     0x0F
+
+/* One virtual console */
+struct vga_console {
+    uint16_t *screen;       /* Top-left cell: VGA memory when in front, else back */
+    size_t row;             /* Cursor position */
+    size_t col;
+    uint8_t color;          /* Current colour attribute */
+    bool cursor_visible;
+    uint16_t back[VGA_MAX_CELLS];
+
+    /* Scrollback history (empty until vga_scrollback_init) */
+    uint8_t *sb_data;       /* Byte ring of line records */
+    size_t sb_data_size;
+    size_t sb_head;         /* Next free byte */
+    size_t sb_used;         /* Bytes held by stored records */
+    uint32_t *sb_lines;     /* Record offsets, oldest at sb_first */
+    size_t sb_max_lines;
+    size_t sb_first;
+    size_t sb_count;
+    size_t sb_view;         /* Lines scrolled back, 0 = live (front only) */
+};
+
+static struct vga_console consoles[VGA_NUM_CONSOLES];
+
+/* Console receiving output, and the one on screen */
+static struct vga_console *con = &consoles[0];
+static struct vga_console *front = &consoles[0];
+
+/* Screen size, and where history views are drawn */
+static size_t screen_cols;
+static size_t screen_rows;
+static size_t screen_cells;
+static uint16_t *history_screen;
+
+/* Output goes to the framebuffer console (vga_use_framebuffer) */
+static bool fb_mode;
+static uint16_t fb_history[VGA_MAX_CELLS];
 
 /*
  * Create a VGA entry (character + color)
@@ -34,15 +117,115 @@ static inline uint16_t vga_entry(unsigned char c, uint8_t color)
     return (uint16_t)c | (uint16_t)color << 8;
 }
 
+/*
+ * Framebuffer: draw what changed on the front screen, or its history view
+ */
+static void vga_present(void)
+{
+    if (front->sb_view) {
+        fbcon_flush(history_screen, 0, 0, false);
+    } else {
+        fbcon_flush(front->screen, front->row, front->col, front->cursor_visible);
+    }
+}
+
+/*
+ * Framebuffer: note count changed cells of the output console, from
+ * row, col on
+ */
+static inline void vga_touch(size_t row, size_t col, size_t count)
+{
+    if (fb_mode && con == front) {
+        fbcon_touch(row, col, count);
+    }
+}
+
+/*
+ * Offset of the front screen from the start of the window, in cells
+ */
+static inline uint16_t vga_origin(void)
+{
+    return (uint16_t)(front->screen - (uint16_t *)VGA_BUFFER);
+}
+
+/*
+ * Point the CRTC display start at the front screen (or its history view)
+ */
+static void vga_update_origin(void)
+{
+    if (fb_mode) {
+        /* Nothing to point at: draw the whole screen instead */
+        fbcon_touch_all();
+        vga_present();
+        return;
+    }
+
+    uint16_t start = front->sb_view ? VGA_LIVE_CELLS : vga_origin();
+
+    outb(VGA_CTRL_PORT, CRTC_START_HIGH);
+    outb(VGA_DATA_PORT, (start >> 8) & 0xFF);
+    outb(VGA_CTRL_PORT, CRTC_START_LOW);
+    outb(VGA_DATA_PORT, start & 0xFF);
+}
+
+/*
+ * Load the cursor shape for the front console
+ */
+static void vga_update_cursor_shape(void)
+{
+    if (fb_mode) {
+        vga_present();
+        return;
+    }
+
+    if (front->cursor_visible) {
+        outb(VGA_CTRL_PORT, 0x0A);
+        outb(VGA_DATA_PORT, (inb(VGA_DATA_PORT) & 0xC0) | 14);  /* Cursor start scanline */
+        outb(VGA_CTRL_PORT, 0x0B);
+        outb(VGA_DATA_PORT, (inb(VGA_DATA_PORT) & 0xE0) | 15);  /* Cursor end scanline */
+    } else {
+        outb(VGA_CTRL_PORT, 0x0A);
+        outb(VGA_DATA_PORT, 0x20);  /* Bit 5 set = cursor disabled */
+    }
+}
+
 /*
  * Initialize VGA driver
  */
 void vga_init(void)
 {
-    vga_row = 0;
-    vga_col = 0;
-    vga_color = VGA_MAKE_COLOR(VGA_COLOR_LIGHT_GREY, VGA_COLOR_BLACK);
-    vga_buffer = (uint16_t *)VGA_BUFFER;
+    screen_cols = VGA_WIDTH;
+    screen_rows = VGA_HEIGHT;
+    screen_cells = VGA_SCREEN_CELLS;
+    history_screen = VGA_HISTORY_SCREEN;
+    fb_mode = false;
+
+    for (int i = 0; i < VGA_NUM_CONSOLES; i++) {
+        struct vga_console *c = &consoles[i];
+
+        c->screen = c->back;
+        c->row = 0;
+        c->col = 0;
+        c->color = VGA_MAKE_COLOR(VGA_COLOR_LIGHT_GREY, VGA_COLOR_BLACK);
+        c->cursor_visible = true;
+        for (size_t j = 0; j < VGA_SCREEN_CELLS; j++) {
+            c->back[j] = vga_entry(' ', c->color);
+        }
+        c->sb_data = NULL;
+        c->sb_lines = NULL;
+        c->sb_data_size = 0;
+        c->sb_max_lines = 0;
+        c->sb_head = 0;
+        c->sb_used = 0;
+        c->sb_first = 0;
+        c->sb_count = 0;
+        c->sb_view = 0;
+    }
+
+    /* Console 0 keeps whatever the boot loader left on screen */
+    con = front = &consoles[0];
+    front->screen = (uint16_t *)VGA_BUFFER;
+    vga_update_origin();
 }
 
 /*
@@ -50,14 +233,22 @@ void vga_init(void)
  */
 void vga_clear(void)
 {
-    for (size_t y = 0; y < VGA_HEIGHT; y++) {
-        for (size_t x = 0; x < VGA_WIDTH; x++) {
-            const size_t index = y * VGA_WIDTH + x;
-            vga_buffer[index] = vga_entry(' ', vga_color);
+    if (con == front) {
+        vga_scroll_view(-(int)front->sb_view);
+
+        /* Back to the start of the window */
+        if (!fb_mode && con->screen != (uint16_t *)VGA_BUFFER) {
+            con->screen = (uint16_t *)VGA_BUFFER;
+            vga_update_origin();
         }
     }
-    vga_row = 0;
-    vga_col = 0;
+
+    for (size_t i = 0; i < screen_cells; i++) {
+        con->screen[i] = vga_entry(' ', con->color);
+    }
+    vga_touch(0, 0, screen_cells);
+    con->row = 0;
+    con->col = 0;
     vga_update_cursor();
 }
 
@@ -66,7 +257,227 @@ void vga_clear(void)
  */
 void vga_set_color(enum vga_color fg, enum vga_color bg)
 {
-    vga_color = VGA_MAKE_COLOR(fg, bg);
+    con->color = VGA_MAKE_COLOR(fg, bg);
+}
+
+/*
+ * Scrollback ring byte access (offsets wrap)
+ */
+static inline uint8_t sb_byte(const struct vga_console *c, size_t offset)
+{
+    return c->sb_data[offset % c->sb_data_size];
+}
+
+/*
+ * Drop the oldest history line
+ */
+static void sb_drop_oldest(struct vga_console *c)
+{
+    size_t offset = c->sb_lines[c->sb_first];
+    c->sb_used -= SB_HEADER_SIZE + sb_byte(c, offset) + 2 * sb_byte(c, offset + 1);
+    c->sb_first = (c->sb_first + 1) % c->sb_max_lines;
+    c->sb_count--;
+}
+
+/*
+ * Append a screen row to the history
+ */
+static void sb_save_row(struct vga_console *c, const uint16_t *row)
+{
+    uint8_t record[SB_MAX_RECORD];
+
+    /* Trim blanks drawn in the colour of the row's last cell */
+    uint8_t fill = row[screen_cols - 1] >> 8;
+    size_t len = screen_cols;
+    while (len > 0 && row[len - 1] == vga_entry(' ', fill)) {
+        len--;
+    }
+
+    size_t size = SB_HEADER_SIZE;
+    size_t runs = 0;
+    for (size_t x = 0; x < len; x++) {
+        record[size++] = row[x] & 0xFF;
+    }
+    for (size_t x = 0; x < len; runs++) {
+        uint8_t attr = row[x] >> 8;
+        size_t run = 1;
+        while (x + run < len && (row[x + run] >> 8) == attr) {
+            run++;
+        }
+        record[size++] = (uint8_t)run;
+        record[size++] = attr;
+        x += run;
+    }
+    record[0] = (uint8_t)len;
+    record[1] = (uint8_t)runs;
+    record[2] = fill;
+
+    while (c->sb_count > 0 &&
+           (c->sb_count == c->sb_max_lines || c->sb_used + size > c->sb_data_size)) {
+        sb_drop_oldest(c);
+    }
+
+    c->sb_lines[(c->sb_first + c->sb_count) % c->sb_max_lines] = c->sb_head;
+    c->sb_count++;
+    for (size_t i = 0; i < size; i++) {
+        c->sb_data[c->sb_head] = record[i];
+        c->sb_head = (c->sb_head + 1) % c->sb_data_size;
+    }
+    c->sb_used += size;
+}
+
+/*
+ * Decode history line index (0 = oldest) into a screen row
+ */
+static void sb_load_row(const struct vga_console *c, size_t index, uint16_t *row)
+{
+    size_t offset = c->sb_lines[(c->sb_first + index) % c->sb_max_lines];
+    size_t len = sb_byte(c, offset);
+    size_t runs = sb_byte(c, offset + 1);
+    uint8_t fill = sb_byte(c, offset + 2);
+    size_t chars = offset + SB_HEADER_SIZE;
+    size_t run_data = chars + len;
+    size_t x = 0;
+
+    for (size_t r = 0; r < runs; r++) {
+        size_t count = sb_byte(c, run_data + 2 * r);
+        uint8_t attr = sb_byte(c, run_data + 2 * r + 1);
+        for (size_t i = 0; i < count; i++, x++) {
+            row[x] = vga_entry(sb_byte(c, chars + x), attr);
+        }
+    }
+    for (; x < screen_cols; x++) {
+        row[x] = vga_entry(' ', fill);
+    }
+}
+
+/*
+ * Draw the history screen for the front console's sb_view: history
+ * lines followed by the top of the live screen
+ */
+static void sb_render(void)
+{
+    uint16_t *screen = history_screen;
+    size_t top = front->sb_count - front->sb_view;
+
+    for (size_t y = 0; y < screen_rows; y++) {
+        size_t line = top + y;
+        if (line < front->sb_count) {
+            sb_load_row(front, line, &screen[y * screen_cols]);
+        } else {
+            memcpy(&screen[y * screen_cols], &front->screen[(line - front->sb_count) * screen_cols],
+                   screen_cols * sizeof(uint16_t));
+        }
+    }
+}
+
+/*
+ * Scrollback memory under pressure: drop the history of every console
+ * that is not being browsed
+ */
+static size_t sb_shrink(size_t wanted)
+{
+    size_t freed = 0;
+
+    for (int i = 0; i < VGA_NUM_CONSOLES && freed < wanted; i++) {
+        struct vga_console *c = &consoles[i];
+        if (c->sb_data == NULL || c->sb_view != 0) {
+            continue;
+        }
+
+        freed += c->sb_data_size + c->sb_max_lines * sizeof(uint32_t);
+        kfree(c->sb_data);
+        kfree(c->sb_lines);
+        c->sb_data = NULL;
+        c->sb_lines = NULL;
+        c->sb_data_size = 0;
+        c->sb_max_lines = 0;
+        c->sb_head = 0;
+        c->sb_used = 0;
+        c->sb_first = 0;
+        c->sb_count = 0;
+    }
+    return freed;
+}
+
+/*
+ * Allocate the scrollback history, lines per console (after memory_init)
+ */
+bool vga_scrollback_init(size_t lines)
+{
+    if (lines == 0) {
+        return false;
+    }
+
+    bool ok = true;
+    for (int i = 0; i < VGA_NUM_CONSOLES; i++) {
+        struct vga_console *c = &consoles[i];
+        if (c->sb_data != NULL) {
+            continue;
+        }
+
+        c->sb_data = kmalloc(lines * SB_BYTES_PER_LINE);
+        c->sb_lines = kmalloc(lines * sizeof(uint32_t));
+        if (c->sb_data == NULL || c->sb_lines == NULL) {
+            kfree(c->sb_data);
+            kfree(c->sb_lines);
+            c->sb_data = NULL;
+            c->sb_lines = NULL;
+            ok = false;
+            continue;
+        }
+
+        c->sb_data_size = lines * SB_BYTES_PER_LINE;
+        c->sb_max_lines = lines;
+        c->sb_head = 0;
+        c->sb_used = 0;
+        c->sb_first = 0;
+        c->sb_count = 0;
+        c->sb_view = 0;
+    }
+
+    static bool registered = false;
+    if (!registered) {
+        memory_register_shrinker("scrollback", SHRINK_PRIO_BUFFER, sb_shrink);
+        registered = true;
+    }
+    return ok;
+}
+
+/*
+ * Move the front console's view lines back into history (negative =
+ * towards the live screen), clamped to what is stored
+ */
+void vga_scroll_view(int lines)
+{
+    size_t view = front->sb_view;
+
+    if (lines > 0) {
+        view += lines;
+        if (view > front->sb_count) {
+            view = front->sb_count;
+        }
+    } else {
+        view = ((size_t)-lines >= view) ? 0 : view + lines;
+    }
+
+    if (view == front->sb_view) {
+        return;
+    }
+
+    front->sb_view = view;
+    if (front->sb_view > 0) {
+        sb_render();
+    }
+    vga_update_origin();
+}
+
+/*
+ * Number of lines held in the output console's history
+ */
+size_t vga_scrollback_lines(void)
+{
+    return con->sb_count;
 }
 
 /*
@@ -74,59 +485,132 @@ void vga_set_color(enum vga_color fg, enum vga_color bg)
  */
 static void vga_scroll(void)
 {
-    /* Move all lines up by one */
-    for (size_t y = 1; y < VGA_HEIGHT; y++) {
-        for (size_t x = 0; x < VGA_WIDTH; x++) {
-            const size_t src = y * VGA_WIDTH + x;
-            const size_t dst = (y - 1) * VGA_WIDTH + x;
-            vga_buffer[dst] = vga_buffer[src];
+    if (con->sb_data != NULL) {
+        sb_save_row(con, con->screen);
+    }
+
+    if (con != front || fb_mode) {
+        /* Screen in RAM: shift the rows up */
+        memmove(con->screen, con->screen + screen_cols, (screen_cells - screen_cols) * sizeof(uint16_t));
+        if (con == front) {
+            fbcon_scroll();
         }
+    } else if (vga_origin() + VGA_SCREEN_CELLS + VGA_WIDTH <= VGA_LIVE_CELLS) {
+        /* Room below the screen: just move the view down a row */
+        con->screen += VGA_WIDTH;
+    } else {
+        /* End of the window: copy the rows that stay visible to its start */
+        uint16_t *base = (uint16_t *)VGA_BUFFER;
+        memcpy(base, con->screen + VGA_WIDTH, (VGA_SCREEN_CELLS - VGA_WIDTH) * sizeof(uint16_t));
+        con->screen = base;
+    }
+
+    /* Clear the new last line before it is shown */
+    for (size_t x = 0; x < screen_cols; x++) {
+        const size_t index = (screen_rows - 1) * screen_cols + x;
+        con->screen[index] = vga_entry(' ', con->color);
     }
+    vga_touch(screen_rows - 1, 0, screen_cols);
 
-    /* Clear the last line */
-    for (size_t x = 0; x < VGA_WIDTH; x++) {
-        const size_t index = (VGA_HEIGHT - 1) * VGA_WIDTH + x;
-        vga_buffer[index] = vga_entry(' ', vga_color);
+    if (con == front && !fb_mode) {
+        vga_update_origin();
     }
 
-    vga_row = VGA_HEIGHT - 1;
+    con->row = screen_rows - 1;
 }
 
 /*
- * Print a single character
+ * Wrap and scroll after the cursor moved past the end of a row
  */
-void vga_putchar(char c)
+static void vga_advance(void)
+{
+    if (con->col >= screen_cols) {
+        con->col = 0;
+        con->row++;
+    }
+
+    if (con->row >= screen_rows) {
+        vga_scroll();
+    }
+}
+
+/*
+ * Store one character without syncing the hardware cursor
+ */
+static void vga_emit(char c)
 {
     if (c == '\n') {
-        vga_col = 0;
-        vga_row++;
+        con->col = 0;
+        con->row++;
     } else if (c == '\r') {
-        vga_col = 0;
+        con->col = 0;
     } else if (c == '\t') {
         /* Tab = 4 spaces */
-        vga_col = (vga_col + 4) & ~3;
+        con->col = (con->col + 4) & ~3;
     } else if (c == '\b') {
         /* Backspace */
-        if (vga_col > 0) {
-            vga_col--;
-            const size_t index = vga_row * VGA_WIDTH + vga_col;
-            vga_buffer[index] = vga_entry(' ', vga_color);
+        if (con->col > 0) {
+            con->col--;
+            const size_t index = con->row * screen_cols + con->col;
+            con->screen[index] = vga_entry(' ', con->color);
+            vga_touch(con->row, con->col, 1);
         }
     } else {
-        const size_t index = vga_row * VGA_WIDTH + vga_col;
-        vga_buffer[index] = vga_entry(c, vga_color);
-        vga_col++;
+        const size_t index = con->row * screen_cols + con->col;
+        con->screen[index] = vga_entry(c, con->color);
+        vga_touch(con->row, con->col, 1);
+        con->col++;
     }
 
-    /* Handle line wrap */
-    if (vga_col >= VGA_WIDTH) {
-        vga_col = 0;
-        vga_row++;
+    vga_advance();
+}
+
+/*
+ * Print a single character
+ */
+void vga_putchar(char c)
+{
+    if (con == front && front->sb_view) {
+        vga_scroll_view(-(int)front->sb_view);
     }
+    vga_emit(c);
+    vga_update_cursor();
+}
 
-    /* Handle scrolling */
-    if (vga_row >= VGA_HEIGHT) {
-        vga_scroll();
+/*
+ * Print len bytes (no terminator needed)
+ *
+ * Runs of ordinary characters are stored straight into the row, and
+ * the hardware cursor is moved once at the end: each cursor update is
+ * four port writes, which are slow (a VM exit each under emulation).
+ */
+void vga_write(const char *data, size_t len)
+{
+    const char *end = data + len;
+
+    /* New output brings the live screen back */
+    if (con == front && front->sb_view) {
+        vga_scroll_view(-(int)front->sb_view);
+    }
+
+    while (data < end) {
+        uint16_t *cell = &con->screen[con->row * screen_cols + con->col];
+        size_t room = screen_cols - con->col;
+        size_t run = 0;
+
+        while (run < room && data + run < end && (unsigned char)data[run] >= ' ') {
+            cell[run] = vga_entry(data[run], con->color);
+            run++;
+        }
+
+        if (run > 0) {
+            vga_touch(con->row, con->col, run);
+            data += run;
+            con->col += run;
+            vga_advance();
+        } else {
+            vga_emit(*data++);
+        }
     }
 
     vga_update_cursor();
@@ -137,9 +621,7 @@ void vga_putchar(char c)
  */
 void vga_print(const char *str)
 {
-    while (*str) {
-        vga_putchar(*str++);
-    }
+    vga_write(str, strlen(str));
 }
 
 /*
@@ -157,31 +639,19 @@ void vga_println(const char *str)
 void vga_print_dec(int32_t num)
 {
     char buffer[12];
-    int i = 0;
-    bool negative = false;
-
-    if (num < 0) {
-        negative = true;
-        num = -num;
-    }
-
-    if (num == 0) {
-        vga_putchar('0');
-        return;
-    }
+    int i = sizeof(buffer);
+    uint32_t value = (num < 0) ? (uint32_t)0 - (uint32_t)num : (uint32_t)num;
 
-    while (num > 0) {
-        buffer[i++] = '0' + (num % 10);
-        num /= 10;
-    }
+    do {
+        buffer[--i] = '0' + (value % 10);
+        value /= 10;
+    } while (value > 0);
 
-    if (negative) {
-        vga_putchar('-');
+    if (num < 0) {
+        buffer[--i] = '-';
     }
 
-    while (--i >= 0) {
-        vga_putchar(buffer[i]);
-    }
+    vga_write(&buffer[i], sizeof(buffer) - i);
 }
 
 /*
@@ -215,11 +685,22 @@ void vga_print_hex(uint32_t num)
  */
 void vga_update_cursor(void)
 {
-    uint16_t pos = vga_row * VGA_WIDTH + vga_col;
+    if (con != front) {
+        return;     /* Loaded when the console comes to the front */
+    }
+
+    if (fb_mode) {
+        /* Draw the pending changes along with the cursor */
+        vga_present();
+        return;
+    }
+
+    /* The cursor address is relative to the window, not the screen */
+    uint16_t pos = vga_origin() + con->row * VGA_WIDTH + con->col;
 
-    outb(VGA_CTRL_PORT, 14);
+    outb(VGA_CTRL_PORT, CRTC_CURSOR_HIGH);
     outb(VGA_DATA_PORT, (pos >> 8) & 0xFF);
-    outb(VGA_CTRL_PORT, 15);
+    outb(VGA_CTRL_PORT, CRTC_CURSOR_LOW);
     outb(VGA_DATA_PORT, pos & 0xFF);
 }
 
@@ -228,9 +709,9 @@ void vga_update_cursor(void)
  */
 void vga_set_cursor(size_t row, size_t col)
 {
-    if (row < VGA_HEIGHT && col < VGA_WIDTH) {
-        vga_row = row;
-        vga_col = col;
+    if (row < screen_rows && col < screen_cols) {
+        con->row = row;
+        con->col = col;
         vga_update_cursor();
     }
 }
@@ -240,7 +721,7 @@ void vga_set_cursor(size_t row, size_t col)
  */
 size_t vga_get_row(void)
 {
-    return vga_row;
+    return con->row;
 }
 
 /*
@@ -248,7 +729,7 @@ size_t vga_get_row(void)
  */
 size_t vga_get_col(void)
 {
-    return vga_col;
+    return con->col;
 }
 
 /*
@@ -256,8 +737,10 @@ size_t vga_get_col(void)
  */
 void vga_hide_cursor(void)
 {
-    outb(VGA_CTRL_PORT, 0x0A);
-    outb(VGA_DATA_PORT, 0x20);  /* Bit 5 set = cursor disabled */
+    con->cursor_visible = false;
+    if (con == front) {
+        vga_update_cursor_shape();
+    }
 }
 
 /*
@@ -265,10 +748,33 @@ void vga_hide_cursor(void)
  */
 void vga_show_cursor(void)
 {
-    outb(VGA_CTRL_PORT, 0x0A);
-    outb(VGA_DATA_PORT, (inb(VGA_DATA_PORT) & 0xC0) | 14);  /* Cursor start scanline */
-    outb(VGA_CTRL_PORT, 0x0B);
-    outb(VGA_DATA_PORT, (inb(VGA_DATA_PORT) & 0xE0) | 15);  /* Cursor end scanline */
+    con->cursor_visible = true;
+    if (con == front) {
+        vga_update_cursor_shape();
+    }
+}
+
+/*
+ * Store a character at a specific position
+ */
+static void vga_store_at(size_t row, size_t col, char c)
+{
+    if (row < screen_rows && col < screen_cols) {
+        const size_t index = row * screen_cols + col;
+        con->screen[index] = vga_entry(c, con->color);
+        vga_touch(row, col, 1);
+    }
+}
+
+/*
+ * Framebuffer: show cells stored without a cursor update (text mode
+ * shows them as they are written)
+ */
+static void vga_sync(void)
+{
+    if (fb_mode && con == front) {
+        vga_present();
+    }
 }
 
 /*
@@ -276,10 +782,8 @@ void vga_show_cursor(void)
  */
 void vga_put_at(size_t row, size_t col, char c)
 {
-    if (row < VGA_HEIGHT && col < VGA_WIDTH) {
-        const size_t index = row * VGA_WIDTH + col;
-        vga_buffer[index] = vga_entry(c, vga_color);
-    }
+    vga_store_at(row, col, c);
+    vga_sync();
 }
 
 /*
@@ -287,25 +791,26 @@ void vga_put_at(size_t row, size_t col, char c)
  */
 void vga_print_at(size_t row, size_t col, const char *str)
 {
-    size_t saved_row = vga_row;
-    size_t saved_col = vga_col;
+    size_t saved_row = con->row;
+    size_t saved_col = con->col;
     
-    vga_row = row;
-    vga_col = col;
+    con->row = row;
+    con->col = col;
     
-    while (*str && vga_col < VGA_WIDTH) {
+    while (*str && con->col < screen_cols) {
         if (*str == '\n') {
-            vga_row++;
-            vga_col = col;  /* Reset to starting column */
+            con->row++;
+            con->col = col;  /* Reset to starting column */
         } else {
-            vga_put_at(vga_row, vga_col, *str);
-            vga_col++;
+            vga_store_at(con->row, con->col, *str);
+            con->col++;
         }
         str++;
     }
     
-    vga_row = saved_row;
-    vga_col = saved_col;
+    con->row = saved_row;
+    con->col = saved_col;
+    vga_sync();
 }
 
 /*
@@ -320,6 +825,139 @@ void vga_print_centered(size_t row, const char *str)
         p++;
     }
     
-    size_t col = (VGA_WIDTH > len) ? (VGA_WIDTH - len) / 2 : 0;
+    size_t col = (screen_cols > len) ? (screen_cols - len) / 2 : 0;
     vga_print_at(row, col, str);
 }
+
+/*
+ * Select the console that receives output
+ */
+void vga_set_console(int index)
+{
+    if (index >= 0 && index < VGA_NUM_CONSOLES) {
+        con = &consoles[index];
+    }
+}
+
+/*
+ * Console receiving output
+ */
+int vga_get_console(void)
+{
+    return (int)(con - consoles);
+}
+
+/*
+ * Console on screen
+ */
+int vga_get_foreground(void)
+{
+    return (int)(front - consoles);
+}
+
+/*
+ * Bring a console to the screen
+ */
+void vga_switch_console(int index)
+{
+    if (index < 0 || index >= VGA_NUM_CONSOLES || &consoles[index] == front) {
+        return;
+    }
+
+    /* Leave history browsing, then park the old screen in RAM */
+    vga_scroll_view(-(int)front->sb_view);
+    if (!fb_mode) {
+        memcpy(front->back, front->screen, VGA_SCREEN_CELLS * sizeof(uint16_t));
+        front->screen = front->back;
+    }
+
+    front = &consoles[index];
+    if (!fb_mode) {
+        front->screen = (uint16_t *)VGA_BUFFER;
+        memcpy(front->screen, front->back, VGA_SCREEN_CELLS * sizeof(uint16_t));
+    }
+    vga_update_origin();
+    vga_update_cursor_shape();
+
+    /* Cursor position of the new front console */
+    struct vga_console *saved = con;
+    con = front;
+    vga_update_cursor();
+    con = saved;
+}
+
+/*
+ * Screen width in cells
+ */
+size_t vga_get_width(void)
+{
+    return screen_cols;
+}
+
+/*
+ * Screen height in cells
+ */
+size_t vga_get_height(void)
+{
+    return screen_rows;
+}
+
+/*
+ * Move the consoles onto the framebuffer console (after fbcon_init)
+ *
+ * Every screen is widened to fbcon's size in place, its text kept in
+ * the top-left corner. Rows are moved bottom up, so none is overwritten
+ * before it has moved.
+ */
+bool vga_use_framebuffer(void)
+{
+    size_t cols = fbcon_get_cols();
+    size_t rows = fbcon_get_rows();
+
+    if (fb_mode || cols < VGA_WIDTH || rows < VGA_HEIGHT ||
+        cols > VGA_MAX_COLS || rows > VGA_MAX_ROWS) {
+        return false;
+    }
+
+    /* Park the front screen in its back buffer, as for a switch */
+    vga_scroll_view(-(int)front->sb_view);
+    memcpy(front->back, front->screen, VGA_SCREEN_CELLS * sizeof(uint16_t));
+
+    for (int i = 0; i < VGA_NUM_CONSOLES; i++) {
+        struct vga_console *c = &consoles[i];
+        uint16_t blank = vga_entry(' ', c->color);
+
+        for (size_t y = rows; y-- > 0; ) {
+            uint16_t *row = &c->back[y * cols];
+            size_t x = 0;
+            if (y < VGA_HEIGHT) {
+                memmove(row, &c->back[y * VGA_WIDTH], VGA_WIDTH * sizeof(uint16_t));
+                x = VGA_WIDTH;
+            }
+            for (; x < cols; x++) {
+                row[x] = blank;
+            }
+        }
+        c->screen = c->back;
+    }
+
+    screen_cols = cols;
+    screen_rows = rows;
+    screen_cells = cols * rows;
+    history_screen = fb_history;
+    fb_mode = true;
+
+    vga_update_origin();
+    return true;
+}
+
+/*
+ * Redraw the whole front screen (framebuffer console; text mode has
+ * nothing to redraw)
+ */
+void vga_redraw(void)
+{
+    if (fb_mode) {
+        vga_update_origin();
+    }
+}
@@ -30,12 +30,25 @@ enum vga_color {
 /* Create a color attribute byte */
 #define VGA_MAKE_COLOR(fg, bg) ((bg) << 4 | (fg))
 
+/* Largest console the framebuffer console can provide */
+#define VGA_MAX_COLS            160
+#define VGA_MAX_ROWS            64
+
+/* Virtual consoles (Alt+F1..F4), each with its own shell session on
+ * its own stack (shell.c) */
+#define VGA_NUM_CONSOLES        4
+
+/* Scrollback history size per console, and lines per PageUp/PageDown */
+#define VGA_SCROLLBACK_LINES    4000
+#define VGA_PAGE_LINES          24
+
 /* VGA driver functions */
 void vga_init(void);
 void vga_clear(void);
 void vga_set_color(enum vga_color fg, enum vga_color bg);
 void vga_putchar(char c);
 void vga_print(const char *str);
+void vga_write(const char *data, size_t len);
 void vga_println(const char *str);
 void vga_print_dec(int32_t num);
 void vga_print_hex(uint32_t num);
@@ -49,4 +62,26 @@ void vga_put_at(size_t row, size_t col, char c);
 void vga_print_at(size_t row, size_t col, const char *str);
 void vga_print_centered(size_t row, const char *str);
 
+/* Screen size in cells (80x25 in text mode) */
+size_t vga_get_width(void);
+size_t vga_get_height(void);
+
+/* Move the consoles onto the framebuffer console (after fbcon_init),
+ * and redraw the whole screen there */
+bool vga_use_framebuffer(void);
+void vga_redraw(void);
+
+/* Scrollback: allocate history for lines rows (needs the heap), then
+ * move the view back (lines > 0) or forward through it */
+bool vga_scrollback_init(size_t lines);
+void vga_scroll_view(int lines);
+size_t vga_scrollback_lines(void);
+
+/* Virtual consoles: output goes to the selected console, which need
+ * not be the one on screen */
+void vga_set_console(int index);
+int vga_get_console(void);
+int vga_get_foreground(void);
+void vga_switch_console(int index);
+
 #endif /* VGA_H */
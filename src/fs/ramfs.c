@@ -4,6 +4,7 @@
 
 #include "ramfs.h"
 #include "../kernel/memory.h"
+#include "../kernel/kbuf.h"
 #include "../lib/string.h"
 
 /* File table */
@@ -91,10 +92,8 @@ int fs_delete(const char *name)
         return -1;  /* File not found */
     }
 
-    /* Free file data */
-    if (file_table[idx].data != NULL) {
-        kfree(file_table[idx].data);
-    }
+    /* Drop the file's reference; open slices keep the data alive */
+    kbuf_put(file_table[idx].data);
 
     /* Clear file entry */
     file_table[idx].name[0] = '\0';
@@ -134,12 +133,56 @@ int fs_read(fs_file_t *file, void *buffer, size_t size, size_t offset)
     size_t to_read = (size < available) ? size : available;
 
     if (file->data != NULL) {
-        memcpy(buffer, file->data + offset, to_read);
+        memcpy(buffer, file->data->data + offset, to_read);
     }
 
     return (int)to_read;
 }
 
+/*
+ * Get a reference to a file's contents without copying them. Later
+ * writes to the file don't affect the slice; release it with
+ * kslice_release().
+ */
+int fs_get_data(fs_file_t *file, struct kslice *slice)
+{
+    if (!file || !slice) {
+        return -1;
+    }
+
+    kbuf_slice(file->data, 0, file->size, slice);
+    return 0;
+}
+
+/*
+ * Make the file's buffer size bytes long, keeping its first bytes.
+ * A buffer someone else still references is left to them and the
+ * kept bytes are copied into a new one.
+ */
+static int fs_resize(fs_file_t *file, size_t size, size_t keep)
+{
+    struct kbuf *buf;
+
+    if (file->data != NULL && !kbuf_shared(file->data)) {
+        buf = kbuf_resize(file->data, size);
+        if (buf == NULL) {
+            return -3;  /* Out of memory */
+        }
+    } else {
+        buf = kbuf_alloc(size);
+        if (buf == NULL) {
+            return -3;  /* Out of memory */
+        }
+        if (keep > 0) {
+            memcpy(buf->data, file->data->data, keep);
+        }
+        kbuf_put(file->data);
+    }
+
+    file->data = buf;
+    return 0;
+}
+
 /*
  * Write to a file (overwrites existing content)
  */
@@ -153,19 +196,15 @@ int fs_write(fs_file_t *file, const void *data, size_t size)
         return -2;  /* Too large */
     }
 
-    /* Free old data */
-    if (file->data != NULL) {
-        kfree(file->data);
+    if (size == 0) {
+        kbuf_put(file->data);
         file->data = NULL;
-    }
-
-    /* Allocate new buffer */
-    if (size > 0) {
-        file->data = kmalloc(size);
-        if (file->data == NULL) {
-            return -3;  /* Out of memory */
+    } else {
+        int result = fs_resize(file, size, 0);
+        if (result < 0) {
+            return result;
         }
-        memcpy(file->data, data, size);
+        memcpy(file->data->data, data, size);
     }
 
     file->size = size;
@@ -186,31 +225,44 @@ int fs_append(fs_file_t *file, const void *data, size_t size)
         return -2;  /* Would be too large */
     }
 
-    /* Allocate new buffer */
-    uint8_t *new_data = kmalloc(new_size);
-    if (new_data == NULL) {
-        return -3;  /* Out of memory */
-    }
-
-    /* Copy old data */
-    if (file->data != NULL && file->size > 0) {
-        memcpy(new_data, file->data, file->size);
+    /* Grow the buffer (in place when nobody else holds it) */
+    int result = fs_resize(file, new_size, file->size);
+    if (result < 0) {
+        return result;
     }
 
     /* Append new data */
-    memcpy(new_data + file->size, data, size);
-
-    /* Free old data */
-    if (file->data != NULL) {
-        kfree(file->data);
-    }
+    memcpy(file->data->data + file->size, data, size);
 
-    file->data = new_data;
     file->size = new_size;
 
     return (int)size;
 }
 
+/*
+ * printf sink appending to the file passed as ctx
+ */
+static void fs_printf_sink(void *ctx, const char *data, size_t len)
+{
+    fs_append((fs_file_t *)ctx, data, len);
+}
+
+/*
+ * Append formatted text to a file
+ */
+int fs_printf(fs_file_t *file, const char *fmt, ...)
+{
+    if (!file || !fmt) {
+        return -1;
+    }
+
+    va_list args;
+    va_start(args, fmt);
+    int result = kvfprintf(fs_printf_sink, file, fmt, args);
+    va_end(args);
+    return result;
+}
+
 /*
  * Truncate a file (clear contents)
  */
@@ -220,10 +272,8 @@ int fs_truncate(fs_file_t *file)
         return -1;
     }
 
-    if (file->data != NULL) {
-        kfree(file->data);
-        file->data = NULL;
-    }
+    kbuf_put(file->data);
+    file->data = NULL;
     file->size = 0;
 
     return 0;
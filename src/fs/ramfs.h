@@ -6,6 +6,8 @@
 #define RAMFS_H
 
 #include "../include/types.h"
+#include "../kernel/kbuf.h"
+#include "../lib/printf.h"
 
 /* Filesystem constants */
 #define FS_MAX_FILES        64
@@ -21,7 +23,7 @@
 /* File structure */
 typedef struct {
     char name[FS_MAX_FILENAME];
-    uint8_t *data;
+    struct kbuf *data;      /* Contents, shared with open slices */
     size_t size;
     uint8_t flags;
 } fs_file_t;
@@ -34,10 +36,14 @@ int fs_create(const char *name);
 int fs_delete(const char *name);
 fs_file_t *fs_open(const char *name);
 int fs_read(fs_file_t *file, void *buffer, size_t size, size_t offset);
+int fs_get_data(fs_file_t *file, struct kslice *slice);
 int fs_write(fs_file_t *file, const void *data, size_t size);
 int fs_append(fs_file_t *file, const void *data, size_t size);
 int fs_truncate(fs_file_t *file);
 
+/* Append formatted text; returns the number of characters formatted */
+int fs_printf(fs_file_t *file, const char *fmt, ...) PRINTF_FORMAT(2, 3);
+
 /* Directory operations */
 int fs_list(char *buffer, size_t buffer_size);
 int fs_exists(const char *name);
@@ -0,0 +1,182 @@
+/*
+ * KontolOS Arena Allocator
+ *
+ * Chunks form a singly linked list with the chunk currently being
+ * bumped at the head. The first chunk is allocated with the arena and
+ * survives resets, so an arena that stays within one chunk never
+ * touches the heap after creation. Requests larger than a quarter of
+ * the chunk size get a chunk of their own, linked behind the head so
+ * that the current chunk keeps filling up.
+ */
+
+#include "arena.h"
+#include "memory.h"
+
+/* Chunk header, followed by the usable bytes */
+struct arena_chunk {
+    struct arena_chunk *next;
+    size_t size;            /* Usable bytes after the header */
+};
+
+struct arena {
+    struct arena_chunk *chunks;     /* Current chunk first */
+    struct arena_chunk *base;       /* First chunk, kept across resets */
+    uint8_t *ptr;                   /* Next free byte in the current chunk */
+    uint8_t *end;                   /* End of the current chunk */
+    size_t chunk_size;
+    size_t allocated;
+};
+
+#define ARENA_ALIGN     8
+
+static inline uint8_t *chunk_data(struct arena_chunk *chunk)
+{
+    return (uint8_t *)chunk + sizeof(struct arena_chunk);
+}
+
+/*
+ * Allocate a chunk with the given number of usable bytes
+ */
+static struct arena_chunk *chunk_alloc(size_t size)
+{
+    if (size > (size_t)-1 - sizeof(struct arena_chunk)) {
+        return NULL;
+    }
+
+    struct arena_chunk *chunk = kmalloc(sizeof(struct arena_chunk) + size);
+    if (chunk != NULL) {
+        chunk->next = NULL;
+        chunk->size = size;
+    }
+    return chunk;
+}
+
+/*
+ * Create an arena
+ */
+struct arena *arena_create(size_t chunk_size)
+{
+    if (chunk_size == 0) {
+        chunk_size = ARENA_CHUNK_SIZE;
+    }
+    chunk_size = (chunk_size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+
+    struct arena *arena = kmalloc(sizeof(struct arena));
+    if (arena == NULL) {
+        return NULL;
+    }
+
+    arena->base = chunk_alloc(chunk_size);
+    if (arena->base == NULL) {
+        kfree(arena);
+        return NULL;
+    }
+
+    arena->chunk_size = chunk_size;
+    arena->chunks = arena->base;
+    arena->ptr = chunk_data(arena->base);
+    arena->end = arena->ptr + chunk_size;
+    arena->allocated = 0;
+    return arena;
+}
+
+/*
+ * Destroy an arena and everything allocated from it
+ */
+void arena_destroy(struct arena *arena)
+{
+    if (arena == NULL) {
+        return;
+    }
+
+    struct arena_chunk *chunk = arena->chunks;
+    while (chunk != NULL) {
+        struct arena_chunk *next = chunk->next;
+        kfree(chunk);
+        chunk = next;
+    }
+    kfree(arena);
+}
+
+/*
+ * Allocate from an arena
+ */
+void *arena_alloc(struct arena *arena, size_t size)
+{
+    if (arena == NULL || size > (size_t)-1 - ARENA_ALIGN) {
+        return NULL;
+    }
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+
+    /* Fast path: bump the pointer */
+    if ((size_t)(arena->end - arena->ptr) >= size) {
+        void *ptr = arena->ptr;
+        arena->ptr += size;
+        arena->allocated += size;
+        return ptr;
+    }
+
+    /* Large request: a dedicated chunk behind the current one */
+    if (size > arena->chunk_size / 4) {
+        struct arena_chunk *chunk = chunk_alloc(size);
+        if (chunk == NULL) {
+            return NULL;
+        }
+        chunk->next = arena->chunks->next;
+        arena->chunks->next = chunk;
+        arena->allocated += size;
+        return chunk_data(chunk);
+    }
+
+    /* Start a new chunk (the rest of the current one is abandoned) */
+    struct arena_chunk *chunk = chunk_alloc(arena->chunk_size);
+    if (chunk == NULL) {
+        return NULL;
+    }
+    chunk->next = arena->chunks;
+    arena->chunks = chunk;
+    arena->ptr = chunk_data(chunk) + size;
+    arena->end = chunk_data(chunk) + arena->chunk_size;
+    arena->allocated += size;
+    return chunk_data(chunk);
+}
+
+/*
+ * Release all allocations, keeping only the first chunk
+ */
+void arena_reset(struct arena *arena)
+{
+    if (arena == NULL) {
+        return;
+    }
+
+    struct arena_chunk *chunk = arena->chunks;
+    while (chunk != NULL) {
+        struct arena_chunk *next = chunk->next;
+        if (chunk != arena->base) {
+            kfree(chunk);
+        }
+        chunk = next;
+    }
+
+    arena->base->next = NULL;
+    arena->chunks = arena->base;
+    arena->ptr = chunk_data(arena->base);
+    arena->end = arena->ptr + arena->chunk_size;
+    arena->allocated = 0;
+}
+
+/*
+ * Get arena statistics
+ */
+void arena_get_stats(struct arena *arena, struct arena_stats *stats)
+{
+    stats->chunks = 0;
+    stats->chunk_bytes = 0;
+    stats->allocated = arena->allocated;
+
+    for (struct arena_chunk *chunk = arena->chunks; chunk != NULL; chunk = chunk->next) {
+        stats->chunks++;
+        stats->chunk_bytes += chunk->size;
+    }
+}
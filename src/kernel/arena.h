@@ -0,0 +1,40 @@
+/*
+ * KontolOS Arena Allocator Header
+ *
+ * An arena hands out memory by bumping a pointer through large chunks
+ * taken from the heap. Individual allocations are never freed; the
+ * whole arena is released at once with arena_reset().
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include "../include/types.h"
+
+/* Default chunk size */
+#define ARENA_CHUNK_SIZE    16384
+
+/* Opaque arena handle */
+struct arena;
+
+/* Arena statistics */
+struct arena_stats {
+    size_t chunks;          /* Chunks currently held */
+    size_t chunk_bytes;     /* Bytes held in chunks */
+    size_t allocated;       /* Bytes handed out since the last reset */
+};
+
+/* Arena management (chunk_size 0 = ARENA_CHUNK_SIZE) */
+struct arena *arena_create(size_t chunk_size);
+void arena_destroy(struct arena *arena);
+
+/* Allocate size bytes, 8-byte aligned (NULL if out of memory) */
+void *arena_alloc(struct arena *arena, size_t size);
+
+/* Release everything allocated so far, keeping the first chunk */
+void arena_reset(struct arena *arena);
+
+/* Statistics */
+void arena_get_stats(struct arena *arena, struct arena_stats *stats);
+
+#endif /* ARENA_H */
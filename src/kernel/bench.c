@@ -0,0 +1,777 @@
+/*
+ * KontolOS Kernel Benchmarks
+ *
+ * In-kernel micro benchmarks, run from the shell with "bench <name>".
+ * Timings are in TSC cycles; each timed span is kept well under 2^32
+ * cycles so the deltas can be handled in 32 bits (no libgcc).
+ */
+
+#include "bench.h"
+#include "kernel.h"
+#include "vga.h"
+#include "fbcon.h"
+#include "memory.h"
+#include "slab.h"
+#include "string.h"
+#include "memops.h"
+#include "timer.h"
+#include "cpu.h"
+
+/* Heap benchmark limits */
+#define BENCH_HEAP_MAX      4096
+#define BENCH_HEAP_DEFAULT  2000
+
+/* Slab benchmark: object layout with a constructor-set field */
+#define BENCH_SLAB_MAGIC    0x51AB0B1Eu
+
+struct bench_slab_obj {
+    uint32_t magic;         /* Set by the constructor, never by users */
+    uint32_t payload[11];
+};
+
+/* Memory bandwidth benchmark: bytes moved per size/variant cell */
+#define BENCH_MEM_BYTES     0x200000    /* 2MB */
+#define BENCH_MEM_MAX_SIZE  0x100000    /* 1MB */
+
+static const uint32_t bench_mem_sizes[] = { 64, 1024, 16384, 262144, 1048576 };
+
+#define BENCH_MEM_NUM_SIZES (int)(sizeof(bench_mem_sizes) / sizeof(bench_mem_sizes[0]))
+
+/* Bulk allocation benchmark: object sizes (exact class, small and large range) */
+static const uint32_t bench_bulk_sizes[] = { 32, 256, 2048 };
+
+#define BENCH_BULK_NUM_SIZES (int)(sizeof(bench_bulk_sizes) / sizeof(bench_bulk_sizes[0]))
+#define BENCH_BULK_ROUNDS   4
+
+/* String benchmark: string lengths and calls per timing */
+static const uint32_t bench_str_lens[] = { 8, 64, 1024 };
+
+#define BENCH_STR_NUM_LENS  (int)(sizeof(bench_str_lens) / sizeof(bench_str_lens[0]))
+#define BENCH_STR_MAX_LEN   1024
+#define BENCH_STR_CALLS     2000
+
+/* Console benchmark: full 80-column lines printed per timing */
+#define BENCH_VGA_LINES     100
+#define BENCH_VGA_COLS      80
+
+/* Framebuffer benchmark: full-screen redraws per timing, blit variants */
+#define BENCH_FB_FRAMES     20
+#define BENCH_FB_MAX_BLITS  4
+
+/* Scratch state shared by the benchmarks */
+static void *bench_ptrs[BENCH_HEAP_MAX];
+static uint16_t bench_order[BENCH_HEAP_MAX];
+static uint32_t bench_seed = 1;
+
+/*
+ * Simple LCG, good enough to scramble sizes and free order
+ */
+static uint32_t bench_rand(void)
+{
+    bench_seed = bench_seed * 1103515245 + 12345;
+    return bench_seed >> 8;
+}
+
+/*
+ * Print "label: value unit"
+ */
+static void bench_report(const char *label, uint32_t value, const char *unit)
+{
+    vga_print("  ");
+    vga_print(label);
+    vga_print_dec((int32_t)value);
+    vga_print(unit);
+    vga_print("\n");
+}
+
+/*
+ * Print a number right-aligned in a field of the given width
+ */
+static void bench_print_col(uint32_t value, int width)
+{
+    int digits = 1;
+    for (uint32_t v = value; v >= 10; v /= 10) {
+        digits++;
+    }
+    for (int i = digits; i < width; i++) {
+        vga_putchar(' ');
+    }
+    vga_print_dec((int32_t)value);
+}
+
+/*
+ * Rate per second for count events in the given number of cycles
+ */
+static uint32_t bench_per_second(uint32_t count, uint32_t cycles, uint32_t tsc_khz)
+{
+    if (cycles == 0) {
+        return 0;
+    }
+    uint64_t scaled = (uint64_t)count * tsc_khz * 1000;
+    if ((uint32_t)(scaled >> 32) >= cycles) {
+        return 0xFFFFFFFF;
+    }
+    return div64_32(scaled, cycles, NULL);
+}
+
+/*
+ * Bandwidth in MB/s for kbytes moved in the given number of cycles
+ * (0xFFFFFFFF if too fast to express)
+ */
+uint32_t bench_mbps(uint32_t kbytes, uint32_t cycles, uint32_t tsc_khz)
+{
+    if (cycles == 0) {
+        return 0;
+    }
+    /* kbytes / 1024 MB over cycles / (tsc_khz * 1000) seconds */
+    uint64_t scaled = (uint64_t)kbytes * tsc_khz * 125 / 128;
+    if ((uint32_t)(scaled >> 32) >= cycles) {
+        return 0xFFFFFFFF;
+    }
+    return div64_32(scaled, cycles, NULL);
+}
+
+/*
+ * Microseconds per event for count events in the given number of cycles
+ */
+static uint32_t bench_usec(uint32_t cycles, uint32_t count, uint32_t tsc_khz)
+{
+    if (count == 0 || tsc_khz == 0) {
+        return 0;
+    }
+    return div64_32((uint64_t)cycles * 1000, tsc_khz * count, NULL);
+}
+
+/*
+ * Memory bandwidth: memcpy, memset and memcmp for every supported
+ * variant across block sizes, in MB/s
+ */
+static void bench_mem(int argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+
+    uint8_t *src = kmalloc(BENCH_MEM_MAX_SIZE);
+    uint8_t *dst = kmalloc(BENCH_MEM_MAX_SIZE);
+    if (src == NULL || dst == NULL) {
+        kfree(src);
+        kfree(dst);
+        vga_print("  Out of memory\n");
+        return;
+    }
+
+    uint32_t tsc_khz = timer_get_tsc_khz();
+    memset(src, 0x5A, BENCH_MEM_MAX_SIZE);
+    memset(dst, 0x5A, BENCH_MEM_MAX_SIZE);
+
+    vga_print("Memory bandwidth (MB/s, TSC ");
+    vga_print_dec((int32_t)(tsc_khz / 1000));
+    vga_print(" MHz), active: ");
+    vga_print(memops_get_active()->name);
+    vga_print("\n");
+
+    static const char *op_names[] = { "memcpy", "memset", "memcmp" };
+
+    for (int op = 0; op < 3; op++) {
+        vga_print("\n  ");
+        vga_print(op_names[op]);
+        vga_print("      ");
+        for (int v = 0; memops_get_variant(v) != NULL; v++) {
+            const struct memops_variant *variant = memops_get_variant(v);
+            if (!cpu_has(variant->features)) {
+                continue;
+            }
+            int len = (int)strlen(variant->name);
+            for (int i = len; i < 8; i++) {
+                vga_putchar(' ');
+            }
+            vga_print(variant->name);
+        }
+        vga_print("\n");
+
+        for (int i = 0; i < BENCH_MEM_NUM_SIZES; i++) {
+            uint32_t size = bench_mem_sizes[i];
+            uint32_t reps = BENCH_MEM_BYTES / size;
+
+            vga_print("  ");
+            bench_print_col(size >= 1024 ? size / 1024 : size, 7);
+            vga_print(size >= 1024 ? " KB " : " B  ");
+
+            for (int v = 0; memops_get_variant(v) != NULL; v++) {
+                const struct memops_variant *variant = memops_get_variant(v);
+                if (!cpu_has(variant->features)) {
+                    continue;
+                }
+
+                uint64_t start = rdtsc();
+                for (uint32_t r = 0; r < reps; r++) {
+                    if (op == 0) {
+                        variant->copy(dst, src, size);
+                    } else if (op == 1) {
+                        variant->set(dst, (int)r, size);
+                    } else {
+                        variant->cmp(dst, src, size);
+                    }
+                }
+                uint32_t cycles = (uint32_t)(rdtsc() - start);
+
+                bench_print_col(bench_mbps(BENCH_MEM_BYTES / 1024, cycles, tsc_khz), 8);
+            }
+            vga_print("\n");
+        }
+
+        /* memcmp has to see equal buffers to scan them fully */
+        if (op == 1) {
+            memset(dst, 0x5A, BENCH_MEM_MAX_SIZE);
+        }
+    }
+
+    kfree(src);
+    kfree(dst);
+}
+
+/*
+ * Heap stress: allocate blocks of random sizes, then free them in a
+ * random order so that merges hit both neighbours, and verify the
+ * heap after every round.
+ */
+static void bench_heap(int argc, char *argv[])
+{
+    int count = (argc > 2) ? atoi(argv[2]) : BENCH_HEAP_DEFAULT;
+    if (count <= 0 || count > BENCH_HEAP_MAX) {
+        count = BENCH_HEAP_DEFAULT;
+    }
+
+    bench_seed = (uint32_t)rdtsc();
+
+    uint32_t alloc_cycles = 0;
+    uint32_t free_cycles = 0;
+    int failed = 0;
+
+    for (int round = 0; round < 4; round++) {
+        /* Allocate: mostly small blocks with some larger ones mixed in */
+        uint64_t start = rdtsc();
+        for (int i = 0; i < count; i++) {
+            size_t size = (bench_rand() & 3) ? (bench_rand() % 128) + 1
+                                             : (bench_rand() % 2048) + 1;
+            bench_ptrs[i] = kmalloc(size);
+            if (bench_ptrs[i] == NULL) {
+                failed++;
+            }
+        }
+        alloc_cycles += (uint32_t)(rdtsc() - start);
+
+        /* Shuffle the free order (Fisher-Yates) */
+        for (int i = 0; i < count; i++) {
+            bench_order[i] = (uint16_t)i;
+        }
+        for (int i = count - 1; i > 0; i--) {
+            int j = bench_rand() % (i + 1);
+            uint16_t tmp = bench_order[i];
+            bench_order[i] = bench_order[j];
+            bench_order[j] = tmp;
+        }
+
+        start = rdtsc();
+        for (int i = 0; i < count; i++) {
+            kfree(bench_ptrs[bench_order[i]]);
+        }
+        free_cycles += (uint32_t)(rdtsc() - start);
+
+        if (memory_check() != 0) {
+            vga_set_color(VGA_COLOR_LIGHT_RED, VGA_COLOR_BLACK);
+            vga_print("  Heap check FAILED after round ");
+            vga_print_dec(round);
+            vga_print("\n");
+            vga_set_color(VGA_COLOR_WHITE, VGA_COLOR_BLACK);
+            return;
+        }
+    }
+
+    uint32_t ops = (uint32_t)count * 4;
+    vga_print("Heap stress (");
+    vga_print_dec(count);
+    vga_print(" blocks x 4 rounds, random free order)\n");
+    bench_report("kmalloc: ", alloc_cycles / ops, " cycles/op");
+    bench_report("kfree:   ", free_cycles / ops, " cycles/op");
+    if (failed) {
+        bench_report("failed allocations: ", failed, "");
+    }
+    vga_set_color(VGA_COLOR_LIGHT_GREEN, VGA_COLOR_BLACK);
+    vga_print("  Heap check OK\n");
+    vga_set_color(VGA_COLOR_WHITE, VGA_COLOR_BLACK);
+}
+
+/*
+ * Bulk allocation: the same batch of equally sized objects allocated
+ * and freed one call at a time, then with kmalloc_bulk/kfree_bulk.
+ */
+static void bench_bulk(int argc, char *argv[])
+{
+    int count = (argc > 2) ? atoi(argv[2]) : BENCH_HEAP_DEFAULT;
+    if (count <= 0 || count > BENCH_HEAP_MAX) {
+        count = BENCH_HEAP_DEFAULT;
+    }
+
+    vga_print("Bulk allocation (");
+    vga_print_dec(count);
+    vga_print(" objects x 4 rounds, cycles/object)\n");
+    vga_print("     Size  kmalloc  kfree   bulk  free_bulk  Speedup\n");
+
+    for (int i = 0; i < BENCH_BULK_NUM_SIZES; i++) {
+        size_t size = bench_bulk_sizes[i];
+        uint32_t single_alloc = 0, single_free = 0;
+        uint32_t bulk_alloc = 0, bulk_free = 0;
+        int failed = 0;
+
+        for (int round = 0; round < BENCH_BULK_ROUNDS; round++) {
+            uint64_t start = rdtsc();
+            for (int j = 0; j < count; j++) {
+                bench_ptrs[j] = kmalloc(size);
+            }
+            single_alloc += (uint32_t)(rdtsc() - start);
+
+            start = rdtsc();
+            for (int j = 0; j < count; j++) {
+                kfree(bench_ptrs[j]);
+            }
+            single_free += (uint32_t)(rdtsc() - start);
+
+            start = rdtsc();
+            size_t got = kmalloc_bulk(size, count, bench_ptrs);
+            bulk_alloc += (uint32_t)(rdtsc() - start);
+            if (got < (size_t)count) {
+                failed++;
+            }
+
+            start = rdtsc();
+            kfree_bulk(bench_ptrs, got);
+            bulk_free += (uint32_t)(rdtsc() - start);
+        }
+
+        uint32_t ops = (uint32_t)count * BENCH_BULK_ROUNDS;
+        uint32_t single = single_alloc + single_free;
+        uint32_t bulk = bulk_alloc + bulk_free;
+
+        bench_print_col(size, 9);
+        bench_print_col(single_alloc / ops, 9);
+        bench_print_col(single_free / ops, 7);
+        bench_print_col(bulk_alloc / ops, 7);
+        bench_print_col(bulk_free / ops, 11);
+
+        /* Speedup of alloc+free with one decimal */
+        uint64_t scaled = (uint64_t)single * 10;
+        uint32_t tenths = (bulk > (uint32_t)(scaled >> 32)) ? div64_32(scaled, bulk, NULL) : 0;
+        bench_print_col(tenths / 10, 7);
+        vga_print(".");
+        vga_print_dec(tenths % 10);
+        vga_print("x");
+        if (failed) {
+            vga_print("  (out of memory)");
+        }
+        vga_print("\n");
+    }
+
+    if (memory_check() != 0) {
+        vga_set_color(VGA_COLOR_LIGHT_RED, VGA_COLOR_BLACK);
+        vga_print("  Heap check FAILED\n");
+    } else {
+        vga_set_color(VGA_COLOR_LIGHT_GREEN, VGA_COLOR_BLACK);
+        vga_print("  Heap check OK\n");
+    }
+    vga_set_color(VGA_COLOR_WHITE, VGA_COLOR_BLACK);
+}
+
+/*
+ * Slab constructor: sets up the state every object should keep
+ */
+static void bench_slab_ctor(void *obj)
+{
+    ((struct bench_slab_obj *)obj)->magic = BENCH_SLAB_MAGIC;
+}
+
+/*
+ * Slab cache: alloc/free cost through a cache with a constructor, and a
+ * check that the constructed field survives an alloc/free/alloc cycle.
+ */
+static void bench_slab(int argc, char *argv[])
+{
+    int count = (argc > 2) ? atoi(argv[2]) : BENCH_HEAP_DEFAULT;
+    if (count <= 0 || count > BENCH_HEAP_MAX) {
+        count = BENCH_HEAP_DEFAULT;
+    }
+
+    struct kmem_cache *cache = kmem_cache_create("bench", sizeof(struct bench_slab_obj),
+                                                 0, 0, bench_slab_ctor);
+    if (cache == NULL) {
+        vga_print("  Cannot create cache\n");
+        return;
+    }
+
+    uint32_t alloc_cycles = 0;
+    uint32_t free_cycles = 0;
+    int failed = 0;
+    int broken = 0;
+
+    for (int round = 0; round < 4; round++) {
+        uint64_t start = rdtsc();
+        for (int i = 0; i < count; i++) {
+            bench_ptrs[i] = kmem_cache_alloc(cache);
+        }
+        alloc_cycles += (uint32_t)(rdtsc() - start);
+
+        /* Objects come back from the free list after the first round */
+        for (int i = 0; i < count; i++) {
+            struct bench_slab_obj *obj = bench_ptrs[i];
+            if (obj == NULL) {
+                failed++;
+            } else {
+                if (obj->magic != BENCH_SLAB_MAGIC) {
+                    broken++;
+                }
+                memset(obj->payload, 0xA5, sizeof(obj->payload));
+            }
+        }
+
+        start = rdtsc();
+        for (int i = 0; i < count; i++) {
+            kmem_cache_free(cache, bench_ptrs[i]);
+        }
+        free_cycles += (uint32_t)(rdtsc() - start);
+    }
+
+    kmem_cache_destroy(cache);
+
+    uint32_t ops = (uint32_t)count * 4;
+    vga_print("Slab cache (");
+    vga_print_dec(count);
+    vga_print(" objects of ");
+    vga_print_dec(sizeof(struct bench_slab_obj));
+    vga_print(" bytes x 4 rounds, with constructor)\n");
+    bench_report("kmem_cache_alloc: ", alloc_cycles / ops, " cycles/op");
+    bench_report("kmem_cache_free:  ", free_cycles / ops, " cycles/op");
+    if (failed) {
+        bench_report("failed allocations: ", failed, "");
+    }
+
+    if (broken) {
+        vga_set_color(VGA_COLOR_LIGHT_RED, VGA_COLOR_BLACK);
+        vga_print("  Constructor check FAILED (");
+        vga_print_dec(broken);
+        vga_print(" objects lost their state)\n");
+    } else {
+        vga_set_color(VGA_COLOR_LIGHT_GREEN, VGA_COLOR_BLACK);
+        vga_print("  Constructor check OK\n");
+    }
+    vga_set_color(VGA_COLOR_WHITE, VGA_COLOR_BLACK);
+}
+
+/*
+ * Byte-at-a-time string loops (the previous string.c versions), kept
+ * as the baseline for "bench str"
+ */
+static size_t byte_strlen(const char *s)
+{
+    size_t len = 0;
+    while (s[len]) {
+        len++;
+    }
+    return len;
+}
+
+static int byte_strcmp(const char *s1, const char *s2)
+{
+    while (*s1 && (*s1 == *s2)) {
+        s1++;
+        s2++;
+    }
+    return *(unsigned char *)s1 - *(unsigned char *)s2;
+}
+
+static char *byte_strchr(const char *s, int c)
+{
+    while (*s) {
+        if (*s == (char)c) {
+            return (char *)s;
+        }
+        s++;
+    }
+    return (c == 0) ? (char *)s : NULL;
+}
+
+static char *byte_strcpy(char *dest, const char *src)
+{
+    char *d = dest;
+    while ((*d++ = *src++));
+    return dest;
+}
+
+static char bench_str_a[BENCH_STR_MAX_LEN + 8];
+static char bench_str_b[BENCH_STR_MAX_LEN + 8];
+static char bench_str_dst[BENCH_STR_MAX_LEN + 8];
+
+/* One benchmark row: the function under test, called on strings of len */
+enum { STR_STRLEN, STR_STRCMP, STR_STRCHR, STR_STRCPY, STR_NUM_FUNCS };
+
+static const char *const bench_str_names[STR_NUM_FUNCS] = {
+    "strlen", "strcmp", "strchr", "strcpy"
+};
+
+static uint32_t bench_str_time(int func, bool swar, const char *a, const char *b)
+{
+    volatile uintptr_t sink = 0;
+    uint64_t start = rdtsc();
+
+    for (int i = 0; i < BENCH_STR_CALLS; i++) {
+        switch (func) {
+        case STR_STRLEN:
+            sink += swar ? strlen(a) : byte_strlen(a);
+            break;
+        case STR_STRCMP:
+            sink += swar ? strcmp(a, b) : byte_strcmp(a, b);
+            break;
+        case STR_STRCHR:
+            sink += (uintptr_t)(swar ? strchr(a, '!') : byte_strchr(a, '!'));
+            break;
+        case STR_STRCPY:
+            sink += (uintptr_t)(swar ? strcpy(bench_str_dst, a) : byte_strcpy(bench_str_dst, a));
+            break;
+        }
+    }
+
+    (void)sink;
+    return (uint32_t)(rdtsc() - start) / BENCH_STR_CALLS;
+}
+
+/*
+ * String kernels: word-at-a-time string.c against the byte loops, on
+ * equal strings (strcmp has to scan them to the end) and a strchr
+ * target that is never found. The second string is misaligned by one
+ * byte to exercise the unaligned strcmp path.
+ */
+static void bench_str(int argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+
+    vga_print("String functions (cycles/call, byte loop vs word at a time)\n");
+    vga_print("  Function    Len   Byte   Word  Speedup\n");
+
+    const char *b = bench_str_b + 1;
+
+    for (int f = 0; f < STR_NUM_FUNCS; f++) {
+        for (int i = 0; i < BENCH_STR_NUM_LENS; i++) {
+            uint32_t len = bench_str_lens[i];
+            for (uint32_t j = 0; j < len; j++) {
+                bench_str_a[j] = 'a' + j % 26;
+                bench_str_b[j + 1] = 'a' + j % 26;
+            }
+            bench_str_a[len] = '\0';
+            bench_str_b[len + 1] = '\0';
+
+            uint32_t byte_cycles = bench_str_time(f, false, bench_str_a, b);
+            uint32_t word_cycles = bench_str_time(f, true, bench_str_a, b);
+
+            vga_print("  ");
+            vga_print(bench_str_names[f]);
+            bench_print_col(len, 9);
+            bench_print_col(byte_cycles, 7);
+            bench_print_col(word_cycles, 7);
+
+            uint32_t tenths = word_cycles ? byte_cycles * 10 / word_cycles : 0;
+            bench_print_col(tenths / 10, 7);
+            vga_print(".");
+            vga_print_dec(tenths % 10);
+            vga_print("x\n");
+        }
+    }
+}
+
+/*
+ * Print BENCH_VGA_LINES lines, either a character at a time (cursor
+ * synced after each one) or with one vga_write per line
+ */
+static uint32_t bench_vga_time(bool bulk, const char *line)
+{
+    uint64_t start = rdtsc();
+
+    for (int i = 0; i < BENCH_VGA_LINES; i++) {
+        if (bulk) {
+            vga_write(line, BENCH_VGA_COLS);
+        } else {
+            for (int j = 0; j < BENCH_VGA_COLS; j++) {
+                vga_putchar(line[j]);
+            }
+        }
+    }
+
+    return (uint32_t)(rdtsc() - start);
+}
+
+/*
+ * Console output rate: vga_putchar loop against vga_write
+ */
+static void bench_vga(int argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+
+    char line[BENCH_VGA_COLS];
+    for (int i = 0; i < BENCH_VGA_COLS - 1; i++) {
+        line[i] = 'a' + i % 26;
+    }
+    line[BENCH_VGA_COLS - 1] = '\n';
+
+    uint32_t tsc_khz = timer_get_tsc_khz();
+    uint32_t putchar_cycles = bench_vga_time(false, line);
+    uint32_t write_cycles = bench_vga_time(true, line);
+    uint32_t chars = BENCH_VGA_LINES * BENCH_VGA_COLS;
+
+    vga_clear();
+    vga_print("Console output (");
+    vga_print_dec(BENCH_VGA_LINES);
+    vga_print(" lines of ");
+    vga_print_dec(BENCH_VGA_COLS);
+    vga_print(" characters)\n");
+    bench_report("vga_putchar: ", bench_per_second(chars, putchar_cycles, tsc_khz), " chars/s");
+    bench_report("vga_write:   ", bench_per_second(chars, write_cycles, tsc_khz), " chars/s");
+
+    uint32_t tenths = write_cycles ? (uint32_t)div64_32((uint64_t)putchar_cycles * 10, write_cycles, NULL) : 0;
+    vga_print("  Speedup:     ");
+    vga_print_dec(tenths / 10);
+    vga_print(".");
+    vga_print_dec(tenths % 10);
+    vga_print("x\n");
+}
+
+/*
+ * Time BENCH_FB_FRAMES full-screen redraws, and one screenful of lines
+ * scrolled in with a flush after each (a pixel move plus one new row)
+ */
+static void bench_fb_time(uint32_t *redraw_cycles, uint32_t *scroll_cycles)
+{
+    uint64_t start = rdtsc();
+    for (int i = 0; i < BENCH_FB_FRAMES; i++) {
+        vga_redraw();
+    }
+    *redraw_cycles = (uint32_t)(rdtsc() - start);
+
+    start = rdtsc();
+    for (size_t i = 0; i < vga_get_height(); i++) {
+        vga_print("\nThe quick brown fox jumps over the lazy dog 0123456789");
+    }
+    *scroll_cycles = (uint32_t)(rdtsc() - start);
+}
+
+/*
+ * Framebuffer console frame times for every supported blit variant,
+ * and the glyph cache and frame statistics since boot
+ */
+static void bench_fb(int argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+
+    struct fbcon_stats stats;
+    if (!fbcon_get_stats(&stats)) {
+        vga_print("  Framebuffer console not active (text mode)\n");
+        return;
+    }
+
+    uint32_t tsc_khz = timer_get_tsc_khz();
+    const struct fbcon_blit *saved = fbcon_get_active_blit();
+    uint32_t redraw[BENCH_FB_MAX_BLITS];
+    uint32_t scroll[BENCH_FB_MAX_BLITS];
+    int count = 0;
+
+    for (int i = 0; i < BENCH_FB_MAX_BLITS; i++) {
+        const struct fbcon_blit *blit = fbcon_get_blit(i);
+        redraw[i] = scroll[i] = 0;
+        if (blit == NULL || !cpu_has(blit->features)) {
+            continue;
+        }
+        fbcon_set_blit(blit);
+        bench_fb_time(&redraw[i], &scroll[i]);
+        count = i + 1;
+    }
+    fbcon_set_blit(saved);
+    fbcon_get_stats(&stats);
+
+    vga_clear();
+    vga_print("Framebuffer console (");
+    vga_print_dec((int32_t)stats.width);
+    vga_print("x");
+    vga_print_dec((int32_t)stats.height);
+    vga_print(", ");
+    vga_print_dec((int32_t)stats.cols);
+    vga_print("x");
+    vga_print_dec((int32_t)stats.rows);
+    vga_print(" cells), active: ");
+    vga_print(saved->name);
+    vga_print("\n  Blit    Redraw us     fps  Scroll us/line\n");
+
+    for (int i = 0; i < count; i++) {
+        if (redraw[i] == 0) {
+            continue;
+        }
+        vga_print("  ");
+        vga_print(fbcon_get_blit(i)->name);
+        for (size_t pad = strlen(fbcon_get_blit(i)->name); pad < 6; pad++) {
+            vga_putchar(' ');
+        }
+        bench_print_col(bench_usec(redraw[i], BENCH_FB_FRAMES, tsc_khz), 11);
+        bench_print_col(bench_per_second(BENCH_FB_FRAMES, redraw[i], tsc_khz), 8);
+        bench_print_col(bench_usec(scroll[i], (uint32_t)stats.rows, tsc_khz), 16);
+        vga_print("\n");
+    }
+
+    uint32_t lookups = stats.glyph_hits + stats.glyph_misses;
+    bench_report("Glyph cache hits:  ", lookups ? div64_32((uint64_t)stats.glyph_hits * 100, lookups, NULL) : 0, "%");
+    bench_report("Frames since boot: ", stats.frames, "");
+    uint32_t average = stats.frames ? div64_32(stats.total_cycles, stats.frames, NULL) : 0;
+    bench_report("Average frame:     ", bench_usec(average, 1, tsc_khz), " us");
+    bench_report("Slowest frame:     ", bench_usec(stats.max_cycles, 1, tsc_khz), " us");
+    bench_report("Scroll copies:     ", stats.scroll_copies, "");
+}
+
+/* Benchmark table */
+struct bench_entry {
+    const char *name;
+    const char *description;
+    void (*run)(int argc, char *argv[]);
+};
+
+static const struct bench_entry benchmarks[] = {
+    { "heap", "kmalloc/kfree stress, random free order [count]", bench_heap },
+    { "mem",  "memcpy/memset/memcmp bandwidth per variant", bench_mem },
+    { "bulk", "kmalloc_bulk/kfree_bulk vs single calls [count]", bench_bulk },
+    { "slab", "kmem_cache alloc/free and constructor check [count]", bench_slab },
+    { "str",  "string.c word-at-a-time vs byte loops", bench_str },
+    { "vga",  "console vga_putchar vs vga_write rate", bench_vga },
+    { "fb",   "framebuffer console frame times per blit variant", bench_fb },
+    { NULL, NULL, NULL }
+};
+
+/*
+ * Shell entry point
+ */
+void bench_run(int argc, char *argv[])
+{
+    if (argc >= 2) {
+        for (int i = 0; benchmarks[i].name != NULL; i++) {
+            if (strcmp(argv[1], benchmarks[i].name) == 0) {
+                benchmarks[i].run(argc, argv);
+                return;
+            }
+        }
+    }
+
+    vga_print("Usage: bench <name> [args]\n");
+    for (int i = 0; benchmarks[i].name != NULL; i++) {
+        vga_print("  ");
+        vga_print(benchmarks[i].name);
+        vga_print(" - ");
+        vga_print(benchmarks[i].description);
+        vga_print("\n");
+    }
+}
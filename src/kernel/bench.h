@@ -0,0 +1,17 @@
+/*
+ * KontolOS Kernel Benchmarks Header
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "../include/types.h"
+
+/* Shell entry point: bench <name> [args] */
+void bench_run(int argc, char *argv[]);
+
+/* Bandwidth in MB/s for kbytes moved in cycles TSC cycles (0xFFFFFFFF
+ * if too fast to express) */
+uint32_t bench_mbps(uint32_t kbytes, uint32_t cycles, uint32_t tsc_khz);
+
+#endif /* BENCH_H */
@@ -0,0 +1,52 @@
+/*
+ * KontolOS Boot Information Header
+ * ============================================================================
+ * Data collected by the Stage 2 bootloader in real mode and handed to
+ * kernel_main (pointer in EBX at kernel entry). Layout must match the
+ * BOOT_INFO_* constants in src/boot/stage2.asm.
+ * ============================================================================
+ */
+
+#ifndef BOOTINFO_H
+#define BOOTINFO_H
+
+#include "../include/types.h"
+
+/* Boot info block location and signature ("KBI1") */
+#define BOOT_INFO_ADDR      0x8000
+#define BOOT_INFO_MAGIC     0x3149424B
+
+/* Maximum number of E820 entries stage 2 collects */
+#define BOOT_MMAP_MAX       64
+
+/* E820 region types */
+#define E820_RAM            1
+#define E820_RESERVED       2
+#define E820_ACPI           3
+#define E820_NVS            4
+#define E820_BAD            5
+
+/* BIOS memory map entry (INT 15h, EAX=E820h) */
+struct e820_entry {
+    uint64_t base;
+    uint64_t length;
+    uint32_t type;
+    uint32_t acpi_attrs;
+} PACKED;
+
+/* Boot information block */
+struct boot_info {
+    uint32_t magic;                 /* BOOT_INFO_MAGIC if valid */
+    uint32_t mmap_count;            /* Number of E820 entries */
+    struct e820_entry *mmap;        /* E820 entries */
+
+    /* VBE linear framebuffer set up by stage 2 (fb_addr 0 = text mode) */
+    uint32_t fb_addr;               /* Physical address */
+    uint32_t fb_pitch;              /* Bytes per scanline */
+    uint32_t fb_width;              /* Pixels */
+    uint32_t fb_height;
+    uint32_t fb_bpp;                /* Bits per pixel (32 = xRGB 8:8:8:8) */
+    const uint8_t *font;            /* 8x16 ROM font, 256 glyphs, or NULL */
+} PACKED;
+
+#endif /* BOOTINFO_H */
@@ -0,0 +1,157 @@
+/*
+ * KontolOS CPU Feature Detection
+ */
+
+#include "cpu.h"
+#include "kernel.h"
+
+/* CPUID leaf 1 EDX bits */
+#define CPUID1_EDX_PSE      (1u << 3)
+#define CPUID1_EDX_TSC      (1u << 4)
+#define CPUID1_EDX_PGE      (1u << 13)
+#define CPUID1_EDX_FXSR     (1u << 24)
+#define CPUID1_EDX_SSE      (1u << 25)
+#define CPUID1_EDX_SSE2     (1u << 26)
+
+/* CPUID leaf 1 ECX bits */
+#define CPUID1_ECX_SSE42    (1u << 20)
+
+/* CPUID leaf 7 EBX bits */
+#define CPUID7_EBX_ERMS     (1u << 9)
+
+/* EFLAGS.ID: writable only if the CPU has CPUID */
+#define EFLAGS_ID           (1u << 21)
+
+/* CR0 / CR4 bits for SSE */
+#define CR0_MP              (1u << 1)
+#define CR0_EM              (1u << 2)
+#define CR0_TS              (1u << 3)
+#define CR4_OSFXSR          (1u << 9)
+#define CR4_OSXMMEXCPT      (1u << 10)
+
+static uint32_t cpu_features = 0;
+static char vendor[13] = "Unknown";
+
+/*
+ * Check for CPUID by trying to flip EFLAGS.ID (386s and early 486s
+ * keep it fixed, and raise #UD on CPUID)
+ */
+static bool cpu_has_cpuid(void)
+{
+    uint32_t before, after;
+
+    __asm__ volatile(
+        "pushf\n\t"
+        "pop %0\n\t"
+        "mov %0, %1\n\t"
+        "xor %2, %1\n\t"
+        "push %1\n\t"
+        "popf\n\t"
+        "pushf\n\t"
+        "pop %1\n\t"
+        "push %0\n\t"
+        "popf"
+        : "=&r"(before), "=&r"(after)
+        : "i"(EFLAGS_ID)
+        : "cc");
+
+    return ((before ^ after) & EFLAGS_ID) != 0;
+}
+
+/*
+ * Detect CPU features
+ */
+void cpu_init(void)
+{
+    uint32_t eax, ebx, ecx, edx;
+
+    cpu_features = 0;
+    if (!cpu_has_cpuid()) {
+        return;     /* No features, vendor stays "Unknown" */
+    }
+
+    /* Leaf 0: highest leaf and vendor string */
+    cpuid(0, 0, &eax, &ebx, &ecx, &edx);
+    uint32_t max_leaf = eax;
+    *(uint32_t *)&vendor[0] = ebx;
+    *(uint32_t *)&vendor[4] = edx;
+    *(uint32_t *)&vendor[8] = ecx;
+    vendor[12] = '\0';
+
+    if (max_leaf < 1) {
+        return;
+    }
+
+    /* Leaf 1: standard feature flags */
+    cpuid(1, 0, &eax, &ebx, &ecx, &edx);
+    if (edx & CPUID1_EDX_TSC) {
+        cpu_features |= CPU_FEATURE_TSC;
+    }
+    if (edx & CPUID1_EDX_PSE) {
+        cpu_features |= CPU_FEATURE_PSE;
+    }
+    if (edx & CPUID1_EDX_PGE) {
+        cpu_features |= CPU_FEATURE_PGE;
+    }
+    if (edx & CPUID1_EDX_FXSR) {
+        cpu_features |= CPU_FEATURE_FXSR;
+    }
+    if (edx & CPUID1_EDX_SSE) {
+        cpu_features |= CPU_FEATURE_SSE;
+    }
+    if (edx & CPUID1_EDX_SSE2) {
+        cpu_features |= CPU_FEATURE_SSE2;
+    }
+    if (ecx & CPUID1_ECX_SSE42) {
+        cpu_features |= CPU_FEATURE_SSE42;
+    }
+
+    if (max_leaf < 7) {
+        return;
+    }
+
+    /* Leaf 7: structured extended feature flags */
+    cpuid(7, 0, &eax, &ebx, &ecx, &edx);
+    if (ebx & CPUID7_EBX_ERMS) {
+        cpu_features |= CPU_FEATURE_ERMS;
+    }
+}
+
+/*
+ * Enable SSE
+ *
+ * The kernel never saves FPU/SSE state, so SSE code must not be
+ * interrupted by other SSE code (see memops.c).
+ */
+bool cpu_enable_sse(void)
+{
+    if (!cpu_has(CPU_FEATURE_SSE | CPU_FEATURE_FXSR)) {
+        cpu_features &= ~(CPU_FEATURE_SSE | CPU_FEATURE_SSE2);
+        return false;
+    }
+
+    uint32_t cr0 = read_cr0();
+    cr0 &= ~(CR0_EM | CR0_TS);
+    cr0 |= CR0_MP;
+    write_cr0(cr0);
+
+    write_cr4(read_cr4() | CR4_OSFXSR | CR4_OSXMMEXCPT);
+    __asm__ volatile("fninit");
+    return true;
+}
+
+/*
+ * Check for a feature
+ */
+bool cpu_has(uint32_t feature)
+{
+    return (cpu_features & feature) == feature;
+}
+
+/*
+ * Get the CPU vendor string
+ */
+const char *cpu_vendor(void)
+{
+    return vendor;
+}
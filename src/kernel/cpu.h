@@ -0,0 +1,32 @@
+/*
+ * KontolOS CPU Feature Detection Header
+ */
+
+#ifndef CPU_H
+#define CPU_H
+
+#include "../include/types.h"
+
+/* Feature flags */
+#define CPU_FEATURE_TSC     0x00000001
+#define CPU_FEATURE_PSE     0x00000002  /* 4MB pages */
+#define CPU_FEATURE_PGE     0x00000004  /* Global pages */
+#define CPU_FEATURE_FXSR    0x00000008  /* FXSAVE/FXRSTOR */
+#define CPU_FEATURE_SSE     0x00000010
+#define CPU_FEATURE_SSE2    0x00000020
+#define CPU_FEATURE_ERMS    0x00000040  /* Enhanced REP MOVSB/STOSB */
+#define CPU_FEATURE_SSE42   0x00000080  /* SSE4.2 (crc32 instruction) */
+
+/* Detect CPU features (CPUID) */
+void cpu_init(void);
+
+/* Check for a feature */
+bool cpu_has(uint32_t feature);
+
+/* Enable SSE instructions (CR0/CR4), returns false if unsupported */
+bool cpu_enable_sse(void);
+
+/* CPU vendor string (12 characters + NUL) */
+const char *cpu_vendor(void);
+
+#endif /* CPU_H */
@@ -5,6 +5,7 @@
 #include "idt.h"
 #include "kernel.h"
 #include "vga.h"
+#include "paging.h"
 
 /* IDT entries */
 static struct idt_entry idt[IDT_ENTRIES];
@@ -254,6 +255,11 @@ void irq_unregister_handler(uint8_t irq)
  */
 void isr_handler(struct interrupt_frame *frame)
 {
+    /* Page faults in the heap range are demand-zero commits */
+    if (frame->int_no == 14 && paging_handle_fault(frame)) {
+        return;
+    }
+
     /* Handle exceptions (0-31) */
     if (frame->int_no < 32) {
         vga_set_color(VGA_COLOR_WHITE, VGA_COLOR_RED);
@@ -272,6 +278,11 @@ void isr_handler(struct interrupt_frame *frame)
         vga_print(" EFLAGS: ");
         vga_print_hex(frame->eflags);
         vga_print("\n");
+        if (frame->int_no == 14) {
+            vga_print("Fault Address: ");
+            vga_print_hex(read_cr2());
+            vga_print("\n");
+        }
 
         /* Halt on exception */
         kernel_panic("Unhandled CPU Exception");
@@ -0,0 +1,125 @@
+/*
+ * KontolOS Shared Buffers
+ *
+ * The reference count sits in front of the bytes in a single heap
+ * block. Counts are updated atomically so that references can also be
+ * dropped from interrupt handlers; the final kbuf_put must not happen
+ * there, since it frees to the heap.
+ */
+
+#include "kbuf.h"
+#include "memory.h"
+#include "kernel.h"
+
+/*
+ * Allocate a buffer of size bytes
+ */
+struct kbuf *kbuf_alloc(size_t size)
+{
+    if (size > KMALLOC_MAX_SIZE - sizeof(struct kbuf)) {
+        return NULL;
+    }
+
+    struct kbuf *buf = kmalloc(sizeof(struct kbuf) + size);
+    if (buf != NULL) {
+        buf->refs = 1;
+        buf->size = size;
+    }
+    return buf;
+}
+
+/*
+ * Take another reference
+ */
+struct kbuf *kbuf_get(struct kbuf *buf)
+{
+    if (buf != NULL) {
+        atomic_add(&buf->refs, 1);
+    }
+    return buf;
+}
+
+/*
+ * Drop a reference, freeing the buffer with the last one
+ */
+void kbuf_put(struct kbuf *buf)
+{
+    if (buf != NULL && atomic_add(&buf->refs, (uint32_t)-1) == 1) {
+        kfree(buf);
+    }
+}
+
+/*
+ * Resize a buffer nobody else holds (in place when the heap allows)
+ */
+struct kbuf *kbuf_resize(struct kbuf *buf, size_t size)
+{
+    if (buf == NULL) {
+        return kbuf_alloc(size);
+    }
+    if (kbuf_shared(buf) || size > KMALLOC_MAX_SIZE - sizeof(struct kbuf)) {
+        return NULL;
+    }
+
+    struct kbuf *new_buf = krealloc(buf, sizeof(struct kbuf) + size);
+    if (new_buf != NULL) {
+        new_buf->size = size;
+    }
+    return new_buf;
+}
+
+/*
+ * Make a slice of len bytes at offset (takes a reference)
+ */
+bool kbuf_slice(struct kbuf *buf, size_t offset, size_t len, struct kslice *slice)
+{
+    size_t size = (buf != NULL) ? buf->size : 0;
+    if (offset > size || len > size - offset) {
+        return false;
+    }
+
+    if (len == 0) {
+        slice->buf = NULL;
+        slice->data = NULL;
+        slice->len = 0;
+        return true;
+    }
+
+    slice->buf = kbuf_get(buf);
+    slice->data = buf->data + offset;
+    slice->len = len;
+    return true;
+}
+
+/*
+ * Make a slice of a slice (takes its own reference)
+ */
+bool kslice_sub(const struct kslice *slice, size_t offset, size_t len, struct kslice *sub)
+{
+    if (offset > slice->len || len > slice->len - offset) {
+        return false;
+    }
+
+    if (len == 0) {
+        sub->buf = NULL;
+        sub->data = NULL;
+        sub->len = 0;
+        return true;
+    }
+
+    sub->buf = kbuf_get(slice->buf);
+    sub->data = slice->data + offset;
+    sub->len = len;
+    return true;
+}
+
+/*
+ * Drop a slice's reference
+ */
+void kslice_release(struct kslice *slice)
+{
+    kbuf_put(slice->buf);
+    slice->buf = NULL;
+    slice->data = NULL;
+    slice->len = 0;
+}
@@ -0,0 +1,47 @@
+/*
+ * KontolOS Shared Buffer Header
+ *
+ * A kbuf is a reference-counted block of bytes. Layers pass references
+ * to the same bytes (whole or sliced) instead of copying them. Once a
+ * kbuf is shared its bytes must not change: writers build a new kbuf
+ * and drop their reference to the old one, so existing readers keep
+ * seeing the old contents.
+ */
+
+#ifndef KBUF_H
+#define KBUF_H
+
+#include "../include/types.h"
+
+struct kbuf {
+    volatile uint32_t refs;
+    size_t size;
+    uint8_t data[];
+};
+
+/* A window onto a kbuf, holding one reference to it */
+struct kslice {
+    struct kbuf *buf;       /* NULL for an empty slice */
+    const uint8_t *data;
+    size_t len;
+};
+
+/* Buffer management (kbuf_alloc returns one reference, contents undefined) */
+struct kbuf *kbuf_alloc(size_t size);
+struct kbuf *kbuf_get(struct kbuf *buf);
+void kbuf_put(struct kbuf *buf);
+
+/* Resize an unshared buffer (NULL on failure, buf is then unchanged) */
+struct kbuf *kbuf_resize(struct kbuf *buf, size_t size);
+
+static inline bool kbuf_shared(const struct kbuf *buf)
+{
+    return buf->refs > 1;
+}
+
+/* Slicing (false if the range is outside the buffer) */
+bool kbuf_slice(struct kbuf *buf, size_t offset, size_t len, struct kslice *slice);
+bool kslice_sub(const struct kslice *slice, size_t offset, size_t len, struct kslice *sub);
+void kslice_release(struct kslice *slice);
+
+#endif /* KBUF_H */
@@ -8,8 +8,17 @@
 #include "idt.h"
 #include "keyboard.h"
 #include "timer.h"
+#include "serial.h"
+#include "fbcon.h"
 #include "shell.h"
 #include "memory.h"
+#include "pmm.h"
+#include "paging.h"
+#include "cpu.h"
+#include "memops.h"
+#include "checksum.h"
+#include "slab.h"
+#include "bootinfo.h"
 #include "../fs/ramfs.h"
 
 /* Kernel version information */
@@ -18,16 +27,24 @@
 
 /* Forward declarations */
 static void show_splash_screen(void);
-static void init_system(void);
+static void init_system(struct boot_info *boot_info);
 
 /*
  * Kernel main entry point
- * Called from kernel_entry.asm after protected mode setup
+ * Called from kernel_entry.asm after protected mode setup, with the
+ * boot info block collected by the Stage 2 bootloader
  */
-void kernel_main(void)
+void kernel_main(struct boot_info *boot_info)
 {
-    /* Initialize VGA text mode */
+    /* CPU features first: memcpy and the framebuffer console pick by them */
+    cpu_init();
+    memops_init();
+
+    /* VGA text mode, moved onto the framebuffer if stage 2 set one up */
     vga_init();
+    if (fbcon_init(boot_info)) {
+        vga_use_framebuffer();
+    }
     vga_clear();
 
     /* Early init: IDT and timer needed for splash screen animation */
@@ -38,7 +55,7 @@ void kernel_main(void)
     show_splash_screen();
 
     /* Initialize remaining system components */
-    init_system();
+    init_system(boot_info);
 
     /* Print ready message */
     vga_set_color(VGA_COLOR_LIGHT_GREEN, VGA_COLOR_BLACK);
@@ -91,7 +108,7 @@ static void show_splash_screen(void)
     /* Loading bar frame (row 20) */
     const size_t bar_row = 20;
     const size_t bar_width = 40;
-    const size_t bar_start = (80 - bar_width - 2) / 2;  /* Center the bar */
+    const size_t bar_start = (vga_get_width() - bar_width - 2) / 2;  /* Center the bar */
     
     vga_set_color(VGA_COLOR_DARK_GREY, VGA_COLOR_BLACK);
     vga_put_at(bar_row, bar_start, '[');
@@ -149,13 +166,62 @@ static void show_splash_screen(void)
 /*
  * Initialize all system components
  */
-static void init_system(void)
+static void init_system(struct boot_info *boot_info)
 {
     vga_set_color(VGA_COLOR_LIGHT_GREY, VGA_COLOR_BLACK);
 
+    /* CPU features were detected first thing in kernel_main */
+    vga_print("[*] Detecting CPU... ");
+    checksum_init();
+    vga_set_color(VGA_COLOR_LIGHT_GREEN, VGA_COLOR_BLACK);
+    vga_print(cpu_vendor());
+    vga_print(" (memcpy: ");
+    vga_print(memops_get_active()->name);
+    vga_print(", crc32c: ");
+    vga_print(crc32c_impl_name());
+    vga_print(")\n");
+    vga_set_color(VGA_COLOR_LIGHT_GREY, VGA_COLOR_BLACK);
+
+    /* Report the console stage 2 left us */
+    vga_print("[*] Display... ");
+    vga_set_color(VGA_COLOR_LIGHT_GREEN, VGA_COLOR_BLACK);
+    struct fbcon_stats fb;
+    if (fbcon_get_stats(&fb)) {
+        vga_print_dec((int32_t)fb.width);
+        vga_print("x");
+        vga_print_dec((int32_t)fb.height);
+        vga_print(" framebuffer, ");
+        vga_print_dec((int32_t)fb.cols);
+        vga_print("x");
+        vga_print_dec((int32_t)fb.rows);
+        vga_print(" console (blit: ");
+        vga_print(fbcon_get_active_blit()->name);
+        vga_print(")\n");
+    } else {
+        vga_print("VGA text 80x25\n");
+    }
+    vga_set_color(VGA_COLOR_LIGHT_GREY, VGA_COLOR_BLACK);
+
+    /* Initialize physical page allocator from the BIOS memory map */
+    vga_print("[*] Detecting physical memory... ");
+    pmm_init(boot_info);
+    vga_set_color(VGA_COLOR_LIGHT_GREEN, VGA_COLOR_BLACK);
+    vga_print_dec(pmm_get_total_pages() / (1024 * 1024 / PAGE_SIZE));
+    vga_print(" MB\n");
+    vga_set_color(VGA_COLOR_LIGHT_GREY, VGA_COLOR_BLACK);
+
+    /* Identity map RAM and the framebuffer, reserve the heap's virtual range */
+    vga_print("[*] Enabling paging... ");
+    paging_init(boot_info);
+    vga_set_color(VGA_COLOR_LIGHT_GREEN, VGA_COLOR_BLACK);
+    vga_print(paging_uses_large_pages() ? "OK (4MB pages)\n" : "OK (4KB pages)\n");
+    vga_set_color(VGA_COLOR_LIGHT_GREY, VGA_COLOR_BLACK);
+
     /* Initialize memory manager */
     vga_print("[*] Initializing memory manager... ");
     memory_init();
+    slab_init();
+    vga_scrollback_init(VGA_SCROLLBACK_LINES);
     vga_set_color(VGA_COLOR_LIGHT_GREEN, VGA_COLOR_BLACK);
     vga_print("OK\n");
     vga_set_color(VGA_COLOR_LIGHT_GREY, VGA_COLOR_BLACK);
@@ -181,6 +247,17 @@ static void init_system(void)
     vga_print("OK\n");
     vga_set_color(VGA_COLOR_LIGHT_GREY, VGA_COLOR_BLACK);
 
+    /* Initialize serial port (log output for kfprintf) */
+    vga_print("[*] Initializing serial port... ");
+    if (serial_init()) {
+        vga_set_color(VGA_COLOR_LIGHT_GREEN, VGA_COLOR_BLACK);
+        vga_print("COM1\n");
+    } else {
+        vga_set_color(VGA_COLOR_LIGHT_BROWN, VGA_COLOR_BLACK);
+        vga_print("not present\n");
+    }
+    vga_set_color(VGA_COLOR_LIGHT_GREY, VGA_COLOR_BLACK);
+
     /* Initialize filesystem */
     vga_print("[*] Initializing filesystem... ");
     fs_init();
@@ -189,6 +266,18 @@ static void init_system(void)
     vga_set_color(VGA_COLOR_LIGHT_GREY, VGA_COLOR_BLACK);
 }
 
+/*
+ * Idle step for wait loops: run one piece of background work if there
+ * is any, otherwise halt until the next interrupt. Callers re-check
+ * their wait condition after every call.
+ */
+void kernel_idle(void)
+{
+    if (!memory_idle()) {
+        halt();
+    }
+}
+
 /*
  * Kernel panic handler
  */
@@ -16,6 +16,13 @@
 /* Kernel panic function */
 void kernel_panic(const char *message);
 
+/* Wait for an interrupt, doing background work first if there is any */
+void kernel_idle(void);
+
+/* Save the callee-saved registers and stack pointer to *save_esp and
+ * resume the context saved at load_esp (switch.asm) */
+void context_switch(uint32_t *save_esp, uint32_t load_esp);
+
 /* Port I/O functions */
 static inline void outb(uint16_t port, uint8_t value)
 {
@@ -70,6 +77,117 @@ static inline void disable_interrupts(void)
     __asm__ volatile("cli");
 }
 
+/* Read the CPU timestamp counter */
+static inline uint64_t rdtsc(void)
+{
+    uint32_t lo, hi;
+    __asm__ volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+/*
+ * 64-by-32 bit division without libgcc. The quotient must fit in 32
+ * bits (high half of dividend < divisor); remainder may be NULL.
+ */
+static inline uint32_t div64_32(uint64_t dividend, uint32_t divisor, uint32_t *remainder)
+{
+    uint32_t quotient, rem;
+    __asm__("divl %4"
+            : "=a"(quotient), "=d"(rem)
+            : "a"((uint32_t)dividend), "d"((uint32_t)(dividend >> 32)), "rm"(divisor));
+    if (remainder != NULL) {
+        *remainder = rem;
+    }
+    return quotient;
+}
+
+/* Disable interrupts, returning the previous EFLAGS */
+static inline uint32_t irq_save(void)
+{
+    uint32_t flags;
+    __asm__ volatile("pushf\n\tpop %0\n\tcli" : "=r"(flags) : : "memory");
+    return flags;
+}
+
+/* Restore the interrupt flag saved by irq_save() */
+static inline void irq_restore(uint32_t flags)
+{
+    __asm__ volatile("push %0\n\tpopf" : : "r"(flags) : "memory", "cc");
+}
+
+/* Atomically add to a 32-bit counter, returning the previous value */
+static inline uint32_t atomic_add(volatile uint32_t *ptr, uint32_t value)
+{
+    __asm__ volatile("lock xaddl %0, %1" : "+r"(value), "+m"(*ptr) : : "memory", "cc");
+    return value;
+}
+
+/*
+ * 64-bit compare-and-swap (cmpxchg8b, Pentium and later). On failure
+ * *expected is updated to the value found in memory.
+ */
+static inline bool cmpxchg64(volatile uint64_t *ptr, uint64_t *expected, uint64_t desired)
+{
+    uint64_t old = *expected;
+    __asm__ volatile("lock cmpxchg8b %1"
+                     : "+A"(*expected), "+m"(*ptr)
+                     : "b"((uint32_t)desired), "c"((uint32_t)(desired >> 32))
+                     : "memory", "cc");
+    return *expected == old;
+}
+
+/* CPUID instruction */
+static inline void cpuid(uint32_t leaf, uint32_t subleaf,
+                         uint32_t *eax, uint32_t *ebx, uint32_t *ecx, uint32_t *edx)
+{
+    __asm__ volatile("cpuid"
+                     : "=a"(*eax), "=b"(*ebx), "=c"(*ecx), "=d"(*edx)
+                     : "a"(leaf), "c"(subleaf));
+}
+
+/* Control register access */
+static inline uint32_t read_cr0(void)
+{
+    uint32_t value;
+    __asm__ volatile("mov %%cr0, %0" : "=r"(value));
+    return value;
+}
+
+static inline void write_cr0(uint32_t value)
+{
+    __asm__ volatile("mov %0, %%cr0" : : "r"(value) : "memory");
+}
+
+static inline uint32_t read_cr2(void)
+{
+    uint32_t value;
+    __asm__ volatile("mov %%cr2, %0" : "=r"(value));
+    return value;
+}
+
+static inline void write_cr3(uint32_t value)
+{
+    __asm__ volatile("mov %0, %%cr3" : : "r"(value) : "memory");
+}
+
+static inline uint32_t read_cr4(void)
+{
+    uint32_t value;
+    __asm__ volatile("mov %%cr4, %0" : "=r"(value));
+    return value;
+}
+
+static inline void write_cr4(uint32_t value)
+{
+    __asm__ volatile("mov %0, %%cr4" : : "r"(value) : "memory");
+}
+
+/* Flush one page from the TLB */
+static inline void invlpg(uintptr_t addr)
+{
+    __asm__ volatile("invlpg (%0)" : : "r"(addr) : "memory");
+}
+
 /* Halt the CPU */
 static inline void halt(void)
 {
@@ -28,7 +28,9 @@ _start:
     mov byte [0xB800C], 'C'
     mov byte [0xB800D], 0x0E
 
-    ; Call the C kernel main function
+    ; Call the C kernel main function with the boot info pointer
+    ; that stage 2 left in EBX
+    push ebx
     call kernel_main
 
     ; DEBUG: Write 'R' if kernel_main returns
@@ -0,0 +1,418 @@
+/*
+ * KontolOS Memory Operations
+ *
+ * memcpy/memset/memcmp come in several variants; memops_init() picks
+ * the best one the CPU supports once at boot. Until then the plain
+ * "rep movsd" variant is used, which runs on any i386.
+ *
+ * The kernel never saves SSE state on interrupts, so the SSE2 loops
+ * run with interrupts disabled, one chunk at a time. Disabling
+ * interrupts does not hold off exceptions, though: a loop touching an
+ * uncommitted heap page takes a page fault in the middle. The fault
+ * path must therefore stay off the XMM registers, which is why
+ * paging.c clears new frames with its own "rep stosd" rather than
+ * memset. Apart from these loops (and fbcon's, which run on memory
+ * that never faults), the C code is built without -msse and leaves
+ * XMM alone.
+ */
+
+#include "memops.h"
+#include "memory.h"
+#include "kernel.h"
+#include "cpu.h"
+
+/* Below this, every variant just copies bytes */
+#define SMALL_SIZE          32
+
+/* Bytes handled per interrupts-off stretch in the SSE2 loops */
+#define SSE_CHUNK           4096
+
+/* Copies and fills this large bypass the cache */
+#define NONTEMPORAL_SIZE    0x40000     /* 256KB */
+
+/*
+ * Byte loops (reference implementation)
+ */
+static void *copy_bytes(void *dest, const void *src, size_t n)
+{
+    uint8_t *d = (uint8_t *)dest;
+    const uint8_t *s = (const uint8_t *)src;
+
+    while (n--) {
+        *d++ = *s++;
+    }
+
+    return dest;
+}
+
+static void *set_bytes(void *s, int c, size_t n)
+{
+    uint8_t *p = (uint8_t *)s;
+
+    while (n--) {
+        *p++ = (uint8_t)c;
+    }
+
+    return s;
+}
+
+static int cmp_bytes(const void *s1, const void *s2, size_t n)
+{
+    const uint8_t *p1 = (const uint8_t *)s1;
+    const uint8_t *p2 = (const uint8_t *)s2;
+
+    while (n--) {
+        if (*p1 != *p2) {
+            return *p1 - *p2;
+        }
+        p1++;
+        p2++;
+    }
+
+    return 0;
+}
+
+/*
+ * String instructions: dword moves with the destination aligned
+ */
+static void *copy_movsd(void *dest, const void *src, size_t n)
+{
+    uint8_t *d = (uint8_t *)dest;
+    const uint8_t *s = (const uint8_t *)src;
+
+    if (n >= SMALL_SIZE) {
+        size_t head = (0 - (uintptr_t)d) & 3;
+        size_t words = (n - head) >> 2;
+        n = (n - head) & 3;
+        __asm__ volatile("rep movsb" : "+D"(d), "+S"(s), "+c"(head) : : "memory");
+        __asm__ volatile("rep movsl" : "+D"(d), "+S"(s), "+c"(words) : : "memory");
+    }
+    __asm__ volatile("rep movsb" : "+D"(d), "+S"(s), "+c"(n) : : "memory");
+
+    return dest;
+}
+
+static void *set_stosd(void *s, int c, size_t n)
+{
+    uint8_t *p = (uint8_t *)s;
+    uint32_t value = (uint8_t)c * 0x01010101u;
+
+    if (n >= SMALL_SIZE) {
+        size_t head = (0 - (uintptr_t)p) & 3;
+        size_t words = (n - head) >> 2;
+        n = (n - head) & 3;
+        __asm__ volatile("rep stosb" : "+D"(p), "+c"(head) : "a"(value) : "memory");
+        __asm__ volatile("rep stosl" : "+D"(p), "+c"(words) : "a"(value) : "memory");
+    }
+    __asm__ volatile("rep stosb" : "+D"(p), "+c"(n) : "a"(value) : "memory");
+
+    return s;
+}
+
+/* Compare a dword at a time, finishing the differing word bytewise */
+static int cmp_dwords(const void *s1, const void *s2, size_t n)
+{
+    const uint8_t *p1 = (const uint8_t *)s1;
+    const uint8_t *p2 = (const uint8_t *)s2;
+
+    while (n >= 4 && *(const uint32_t *)p1 == *(const uint32_t *)p2) {
+        p1 += 4;
+        p2 += 4;
+        n -= 4;
+    }
+
+    return cmp_bytes(p1, p2, n);
+}
+
+/*
+ * Enhanced REP MOVSB/STOSB: the microcode picks the best strategy
+ */
+static void *copy_erms(void *dest, const void *src, size_t n)
+{
+    void *d = dest;
+
+    __asm__ volatile("rep movsb" : "+D"(d), "+S"(src), "+c"(n) : : "memory");
+    return dest;
+}
+
+static void *set_erms(void *s, int c, size_t n)
+{
+    void *p = s;
+
+    __asm__ volatile("rep stosb" : "+D"(p), "+c"(n) : "a"(c) : "memory");
+    return s;
+}
+
+/*
+ * SSE2: 64 bytes per iteration, aligned stores
+ */
+static void *copy_sse2(void *dest, const void *src, size_t n)
+{
+    if (n < 64) {
+        return copy_movsd(dest, src, n);
+    }
+
+    uint8_t *d = (uint8_t *)dest;
+    const uint8_t *s = (const uint8_t *)src;
+    bool stream = n >= NONTEMPORAL_SIZE;
+
+    /* Align the destination to 16 bytes */
+    size_t head = (0 - (uintptr_t)d) & 15;
+    copy_movsd(d, s, head);
+    d += head;
+    s += head;
+    n -= head;
+
+    while (n >= 64) {
+        size_t chunk = (n > SSE_CHUNK) ? SSE_CHUNK : (n & ~(size_t)63);
+        n -= chunk;
+
+        uint32_t flags = irq_save();
+        if (stream) {
+            __asm__ volatile(
+                "1:\n\t"
+                "movdqu (%1), %%xmm0\n\t"
+                "movdqu 16(%1), %%xmm1\n\t"
+                "movdqu 32(%1), %%xmm2\n\t"
+                "movdqu 48(%1), %%xmm3\n\t"
+                "movntdq %%xmm0, (%0)\n\t"
+                "movntdq %%xmm1, 16(%0)\n\t"
+                "movntdq %%xmm2, 32(%0)\n\t"
+                "movntdq %%xmm3, 48(%0)\n\t"
+                "add $64, %1\n\t"
+                "add $64, %0\n\t"
+                "sub $64, %2\n\t"
+                "jnz 1b\n\t"
+                "sfence"
+                : "+r"(d), "+r"(s), "+r"(chunk) : : "memory", "cc");
+        } else {
+            __asm__ volatile(
+                "1:\n\t"
+                "movdqu (%1), %%xmm0\n\t"
+                "movdqu 16(%1), %%xmm1\n\t"
+                "movdqu 32(%1), %%xmm2\n\t"
+                "movdqu 48(%1), %%xmm3\n\t"
+                "movdqa %%xmm0, (%0)\n\t"
+                "movdqa %%xmm1, 16(%0)\n\t"
+                "movdqa %%xmm2, 32(%0)\n\t"
+                "movdqa %%xmm3, 48(%0)\n\t"
+                "add $64, %1\n\t"
+                "add $64, %0\n\t"
+                "sub $64, %2\n\t"
+                "jnz 1b"
+                : "+r"(d), "+r"(s), "+r"(chunk) : : "memory", "cc");
+        }
+        irq_restore(flags);
+    }
+
+    copy_movsd(d, s, n);
+    return dest;
+}
+
+static void *set_sse2(void *s, int c, size_t n)
+{
+    if (n < 64) {
+        return set_stosd(s, c, n);
+    }
+
+    uint8_t *p = (uint8_t *)s;
+    uint32_t value = (uint8_t)c * 0x01010101u;
+    bool stream = n >= NONTEMPORAL_SIZE;
+
+    size_t head = (0 - (uintptr_t)p) & 15;
+    set_stosd(p, c, head);
+    p += head;
+    n -= head;
+
+    while (n >= 64) {
+        size_t chunk = (n > SSE_CHUNK) ? SSE_CHUNK : (n & ~(size_t)63);
+        n -= chunk;
+
+        uint32_t flags = irq_save();
+        __asm__ volatile(
+            "movd %0, %%xmm0\n\t"
+            "pshufd $0, %%xmm0, %%xmm0"
+            : : "r"(value));
+        if (stream) {
+            __asm__ volatile(
+                "1:\n\t"
+                "movntdq %%xmm0, (%0)\n\t"
+                "movntdq %%xmm0, 16(%0)\n\t"
+                "movntdq %%xmm0, 32(%0)\n\t"
+                "movntdq %%xmm0, 48(%0)\n\t"
+                "add $64, %0\n\t"
+                "sub $64, %1\n\t"
+                "jnz 1b\n\t"
+                "sfence"
+                : "+r"(p), "+r"(chunk) : : "memory", "cc");
+        } else {
+            __asm__ volatile(
+                "1:\n\t"
+                "movdqa %%xmm0, (%0)\n\t"
+                "movdqa %%xmm0, 16(%0)\n\t"
+                "movdqa %%xmm0, 32(%0)\n\t"
+                "movdqa %%xmm0, 48(%0)\n\t"
+                "add $64, %0\n\t"
+                "sub $64, %1\n\t"
+                "jnz 1b"
+                : "+r"(p), "+r"(chunk) : : "memory", "cc");
+        }
+        irq_restore(flags);
+    }
+
+    set_stosd(p, c, n);
+    return s;
+}
+
+/* Compare 16 bytes at a time; the mismatching block is finished bytewise */
+static int cmp_sse2(const void *s1, const void *s2, size_t n)
+{
+    const uint8_t *p1 = (const uint8_t *)s1;
+    const uint8_t *p2 = (const uint8_t *)s2;
+
+    while (n >= 16) {
+        size_t chunk = (n > SSE_CHUNK) ? SSE_CHUNK : (n & ~(size_t)15);
+        size_t offset = 0;
+        uint32_t mask;
+
+        uint32_t flags = irq_save();
+        __asm__ volatile(
+            "1:\n\t"
+            "movdqu (%2,%0), %%xmm0\n\t"
+            "movdqu (%3,%0), %%xmm1\n\t"
+            "pcmpeqb %%xmm1, %%xmm0\n\t"
+            "pmovmskb %%xmm0, %1\n\t"
+            "cmp $0xFFFF, %1\n\t"
+            "jne 2f\n\t"
+            "add $16, %0\n\t"
+            "cmp %4, %0\n\t"
+            "jb 1b\n\t"
+            "2:"
+            : "+r"(offset), "=&r"(mask)
+            : "r"(p1), "r"(p2), "r"(chunk)
+            : "memory", "cc");
+        irq_restore(flags);
+
+        p1 += offset;
+        p2 += offset;
+        n -= offset;
+        if (offset < chunk) {
+            break;      /* Difference within the next 16 bytes */
+        }
+    }
+
+    return cmp_bytes(p1, p2, n);
+}
+
+/* Variant table, in order of preference (best last) */
+static const struct memops_variant variants[] = {
+    { "byte",  0,                  copy_bytes, set_bytes, cmp_bytes  },
+    { "movsd", 0,                  copy_movsd, set_stosd, cmp_dwords },
+    { "sse2",  CPU_FEATURE_SSE2,   copy_sse2,  set_sse2,  cmp_sse2   },
+    { "erms",  CPU_FEATURE_ERMS,   copy_erms,  set_erms,  cmp_dwords },
+};
+
+#define NUM_VARIANTS    (int)(sizeof(variants) / sizeof(variants[0]))
+
+static const struct memops_variant *active = &variants[1];
+
+/*
+ * Pick the best supported variant (needs cpu_init first)
+ */
+void memops_init(void)
+{
+    cpu_enable_sse();
+
+    for (int i = 0; i < NUM_VARIANTS; i++) {
+        if (cpu_has(variants[i].features)) {
+            active = &variants[i];
+        }
+    }
+}
+
+/*
+ * Get a variant by index (NULL past the end)
+ */
+const struct memops_variant *memops_get_variant(int index)
+{
+    if (index < 0 || index >= NUM_VARIANTS) {
+        return NULL;
+    }
+    return &variants[index];
+}
+
+/*
+ * Get the variant in use
+ */
+const struct memops_variant *memops_get_active(void)
+{
+    return active;
+}
+
+/*
+ * Memory copy
+ */
+void *memcpy(void *dest, const void *src, size_t n)
+{
+    return active->copy(dest, src, n);
+}
+
+/*
+ * Memory set
+ */
+void *memset(void *s, int c, size_t n)
+{
+    return active->set(s, c, n);
+}
+
+/*
+ * Memory compare
+ */
+int memcmp(const void *s1, const void *s2, size_t n)
+{
+    return active->cmp(s1, s2, n);
+}
+
+/*
+ * Memory move (handles overlapping regions)
+ *
+ * Copying forwards is safe unless dest starts inside [src, src + n);
+ * every variant loads a block before storing it, so it also holds for
+ * overlapping moves downwards.
+ */
+void *memmove(void *dest, const void *src, size_t n)
+{
+    uint8_t *d = (uint8_t *)dest;
+    const uint8_t *s = (const uint8_t *)src;
+
+    if (d == s || n == 0) {
+        return dest;
+    }
+    if ((uintptr_t)d - (uintptr_t)s >= n) {
+        return active->copy(dest, src, n);
+    }
+
+    /*
+     * Copy downwards: odd tail bytes first, then whole dwords. Interrupt
+     * handlers expect the direction flag clear, so keep them out.
+     */
+    size_t tail = n & 3;
+    size_t words = n >> 2;
+    d += n - 1;
+    s += n - 1;
+    uint32_t flags = irq_save();
+    __asm__ volatile(
+        "std\n\t"
+        "rep movsb\n\t"
+        "sub $3, %%esi\n\t"
+        "sub $3, %%edi\n\t"
+        "mov %3, %%ecx\n\t"
+        "rep movsl\n\t"
+        "cld"
+        : "+D"(d), "+S"(s), "+c"(tail)
+        : "r"(words)
+        : "memory", "cc");
+    irq_restore(flags);
+
+    return dest;
+}
@@ -0,0 +1,29 @@
+/*
+ * KontolOS Memory Operations Header
+ *
+ * memcpy and friends are declared in memory.h; this interface selects
+ * and inspects the implementation behind them.
+ */
+
+#ifndef MEMOPS_H
+#define MEMOPS_H
+
+#include "../include/types.h"
+
+/* One implementation of the mem* family */
+struct memops_variant {
+    const char *name;
+    uint32_t features;      /* Required CPU features (CPU_FEATURE_*) */
+    void *(*copy)(void *dest, const void *src, size_t n);
+    void *(*set)(void *s, int c, size_t n);
+    int (*cmp)(const void *s1, const void *s2, size_t n);
+};
+
+/* Enable SSE and pick the best variant (needs cpu_init first) */
+void memops_init(void);
+
+/* Variant table access (NULL past the end) */
+const struct memops_variant *memops_get_variant(int index);
+const struct memops_variant *memops_get_active(void);
+
+#endif /* MEMOPS_H */
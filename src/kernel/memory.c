@@ -5,82 +5,778 @@
 #include "memory.h"
 #include "kernel.h"
 #include "vga.h"
+#include "pmm.h"
+#include "paging.h"
 
-/* Memory layout constants */
-#define HEAP_START      0x200000    /* Start of heap at 2MB */
-#define HEAP_SIZE       0x400000    /* 4MB heap */
-#define HEAP_END        (HEAP_START + HEAP_SIZE)
+/*
+ * Heap sizing
+ *
+ * The heap lives in the virtual range reserved by the paging code and
+ * its pages are only backed by RAM once they are touched, so reserving
+ * address space is free. The heap starts at HEAP_INITIAL_SIZE and grows
+ * upwards in HEAP_GROW_SIZE steps, as long as there are enough free
+ * page frames left to back the new space.
+ */
+#define HEAP_INITIAL_SIZE   0x400000    /* 4MB */
+#define HEAP_GROW_SIZE      0x100000    /* 1MB */
+#define HEAP_MAX_REGIONS    32
 
-/* Block header structure */
+/* Registered memory pressure callbacks */
+#define MAX_SHRINKERS       8
+
+/*
+ * Block header structure (boundary tags)
+ *
+ * Blocks are laid out back to back within a heap region, so the next
+ * block is always at block + size. Each header also records the size of the
+ * block physically before it, which makes both neighbours reachable in
+ * constant time. The low bits of size are always zero (sizes are
+ * multiples of 8), so bit 0 doubles as the "in use" flag.
+ *
+ * Bit 1 marks a free block as pre-zeroed: every payload byte after its
+ * free list links is known to be zero. Fresh heap memory starts out that
+ * way, and the idle loop zeroes other free blocks in the background, so
+ * kcalloc can usually skip clearing the memory it hands out.
+ *
+ * The last header in each region is a permanently used fence block
+ * that stops forward coalescing; the first block has prev_size == 0.
+ *
+ * Builds with HEAP_TAGS also record who allocated each block and how
+ * much they asked for, which heapstat groups by call site.
+ */
 struct mem_block {
-    size_t size;            /* Size of the block (including header) */
-    bool used;              /* Is this block in use? */
-    struct mem_block *next; /* Next block in the list */
+    size_t size;            /* Size of the block (including header) | BLOCK_USED */
+    size_t prev_size;       /* Size of the previous block, 0 if none */
+#ifdef HEAP_TAGS
+    uintptr_t caller;       /* Return address of the allocating call */
+    size_t req_size;        /* Size requested by the caller */
+#endif
+};
+
+#define BLOCK_USED      0x1
+#define BLOCK_ZERO      0x2
+#define BLOCK_SIZE_MASK (~(size_t)7)
+
+/*
+ * Free blocks keep their free list links in the (otherwise unused)
+ * payload, so a block must be able to hold them once it is freed.
+ */
+struct free_links {
+    struct mem_block *prev_free;
+    struct mem_block *next_free;
+};
+
+#define HEADER_SIZE     sizeof(struct mem_block)
+#define MIN_PAYLOAD     sizeof(struct free_links)
+#define MIN_BLOCK_SIZE  (HEADER_SIZE + MIN_PAYLOAD)
+
+/*
+ * Idle-time zeroing: only blocks above the exact classes are worth it.
+ * Each idle step clears at most IDLE_ZERO_BYTES, or skips at most
+ * IDLE_SKIP_PAGES pages that were never touched (those read as zero).
+ */
+#define IDLE_ZERO_BYTES 16384
+#define IDLE_SKIP_PAGES 256
+
+/*
+ * Tag a freshly allocated payload with the calling function. A macro,
+ * so that the return address is that of the public entry point.
+ */
+#ifdef HEAP_TAGS
+#define HEAP_TAG(ptr, size) heap_tag((ptr), (uintptr_t)__builtin_return_address(0), (size))
+#define MAX_CALL_SITES  64
+#else
+#define HEAP_TAG(ptr, size) ((void)(size), (ptr))
+#endif
+
+/*
+ * Size classes (by payload size, always a multiple of 8):
+ *   classes  0..15 - exact sizes 8, 16, ..., 128
+ *   classes 16..30 - power-of-two ranges (128, 256], (256, 512], ...
+ *   class  31      - everything larger (the "large block" list)
+ * Every block on an exact list fits any request of that class, so
+ * small allocations never have to walk a list.
+ */
+#define EXACT_MAX       KMALLOC_EXACT_MAX
+#define EXACT_CLASSES   (EXACT_MAX / 8)
+
+/* memory.h computes constant-size classes with the same rules */
+_Static_assert(KMALLOC_MIN_PAYLOAD == MIN_PAYLOAD, "kmalloc minimum payload mismatch");
+
+/* Heap regions: contiguous runs of blocks, each ending in a fence */
+struct heap_region {
+    uint8_t *start;
+    uint8_t *end;
 };
 
 /* Memory manager state */
-static struct mem_block *heap_start = NULL;
+static struct heap_region regions[HEAP_MAX_REGIONS];
+static int region_count = 0;
+static uint8_t *heap_brk = NULL;   /* End of the heap's used virtual range */
 static size_t total_memory = 0;
 static size_t used_memory = 0;
+static size_t peak_used = 0;        /* High-water mark of used_memory */
+
+/* Segregated free lists, one per size class */
+static struct mem_block *free_lists[MEM_NUM_CLASSES];
+static uint32_t free_bitmap = 0;    /* Bit n set = free_lists[n] non-empty */
+
+/* Per-class occupancy counters */
+static struct mem_class_stats class_stats[MEM_NUM_CLASSES];
+
+/* Free blocks not yet zeroed, per class */
+static size_t dirty_blocks[MEM_NUM_CLASSES];
+
+/* Shrinkers, sorted by priority (lowest first) */
+struct shrinker {
+    const char *name;
+    int priority;
+    shrinker_fn_t fn;
+    uint32_t calls;
+    size_t reclaimed;
+};
+
+static struct shrinker shrinkers[MAX_SHRINKERS];
+static int shrinker_count = 0;
+static bool reclaiming = false;     /* Shrinkers must not recurse into reclaim */
+
+/* Block being zeroed by the idle loop, and how far it got */
+static struct mem_block *zero_cursor = NULL;
+static size_t zero_offset = 0;
+static size_t idle_zeroed_bytes = 0;
+
+static inline size_t block_size(struct mem_block *block)
+{
+    return block->size & BLOCK_SIZE_MASK;
+}
+
+static inline bool block_used(struct mem_block *block)
+{
+    return (block->size & BLOCK_USED) != 0;
+}
+
+static inline bool block_zeroed(struct mem_block *block)
+{
+    return (block->size & BLOCK_ZERO) != 0;
+}
+
+static inline struct mem_block *block_next(struct mem_block *block)
+{
+    return (struct mem_block *)((uint8_t *)block + block_size(block));
+}
+
+static inline struct mem_block *block_prev(struct mem_block *block)
+{
+    return block->prev_size ? (struct mem_block *)((uint8_t *)block - block->prev_size) : NULL;
+}
+
+static inline struct free_links *block_links(struct mem_block *block)
+{
+    return (struct free_links *)((uint8_t *)block + HEADER_SIZE);
+}
+
+/*
+ * Map a payload size (multiple of 8, at least 8) to its size class
+ */
+static inline int size_to_class(size_t payload)
+{
+    /* Range classes: ceil(log2(payload)) + 8, i.e. 16 for (128, 256], ... */
+    return KMALLOC_CLASS(payload);
+}
+
+/*
+ * Add a block to the head of its class free list
+ */
+static void free_list_insert(struct mem_block *block)
+{
+    size_t payload = block_size(block) - HEADER_SIZE;
+    int cls = size_to_class(payload);
+    struct free_links *links = block_links(block);
+
+    links->prev_free = NULL;
+    links->next_free = free_lists[cls];
+    if (free_lists[cls] != NULL) {
+        block_links(free_lists[cls])->prev_free = block;
+    }
+    free_lists[cls] = block;
+    free_bitmap |= 1u << cls;
+
+    class_stats[cls].free_blocks++;
+    class_stats[cls].free_bytes += payload;
+    if (!block_zeroed(block)) {
+        dirty_blocks[cls]++;
+    }
+}
+
+/*
+ * Unlink a block from its class free list
+ */
+static void free_list_remove(struct mem_block *block)
+{
+    size_t payload = block_size(block) - HEADER_SIZE;
+    int cls = size_to_class(payload);
+    struct free_links *links = block_links(block);
+
+    if (links->prev_free != NULL) {
+        block_links(links->prev_free)->next_free = links->next_free;
+    } else {
+        free_lists[cls] = links->next_free;
+        if (free_lists[cls] == NULL) {
+            free_bitmap &= ~(1u << cls);
+        }
+    }
+    if (links->next_free != NULL) {
+        block_links(links->next_free)->prev_free = links->prev_free;
+    }
+
+    class_stats[cls].free_blocks--;
+    class_stats[cls].free_bytes -= payload;
+    if (!block_zeroed(block)) {
+        dirty_blocks[cls]--;
+    }
+
+    /* The idle loop must not keep writing into a block that changed */
+    if (block == zero_cursor) {
+        zero_cursor = NULL;
+    }
+}
+
+/*
+ * Find a free block with at least the given payload (of class cls)
+ * and unlink it
+ */
+static struct mem_block *find_free_block(int cls, size_t payload)
+{
+    /* Exact classes: any block on the list is a perfect fit */
+    if (cls < EXACT_CLASSES && free_lists[cls] != NULL) {
+        struct mem_block *block = free_lists[cls];
+        free_list_remove(block);
+        return block;
+    }
+
+    /* Range classes: first fit within the request's own class */
+    if (cls >= EXACT_CLASSES) {
+        struct mem_block *block = free_lists[cls];
+        while (block != NULL) {
+            if (block_size(block) - HEADER_SIZE >= payload) {
+                free_list_remove(block);
+                return block;
+            }
+            block = block_links(block)->next_free;
+        }
+    }
+
+    /* Otherwise the smallest non-empty larger class always fits */
+    uint32_t larger = (cls + 1 < MEM_NUM_CLASSES) ? free_bitmap & ~((2u << cls) - 1) : 0;
+    if (larger == 0) {
+        return NULL;
+    }
+
+    struct mem_block *block = free_lists[__builtin_ctz(larger)];
+    free_list_remove(block);
+    return block;
+}
+
+/*
+ * Hand out a free (already unlinked) block for a request of total_size
+ * bytes, returning any usable tail to the free lists
+ */
+static void *block_allocate(struct mem_block *block, size_t total_size)
+{
+    /* Split the block if the remainder can stand on its own */
+    if (block_size(block) >= total_size + MIN_BLOCK_SIZE) {
+        struct mem_block *new_block = (struct mem_block *)((uint8_t *)block + total_size);
+        new_block->size = (block_size(block) - total_size) | (block->size & BLOCK_ZERO);
+        new_block->prev_size = total_size;
+        block_next(new_block)->prev_size = block_size(new_block);
+        free_list_insert(new_block);
+
+        block->size = total_size;
+    }
+
+    /* Used blocks are never considered zeroed */
+    block->size = block_size(block) | BLOCK_USED;
+    used_memory += block_size(block);
+    if (used_memory > peak_used) {
+        peak_used = used_memory;
+    }
+
+    int cls = size_to_class(block_size(block) - HEADER_SIZE);
+    class_stats[cls].used_blocks++;
+    class_stats[cls].used_bytes += block_size(block) - HEADER_SIZE;
+
+    /* Return pointer to usable memory (after header) */
+    return (void *)((uint8_t *)block + HEADER_SIZE);
+}
+
+#ifdef HEAP_TAGS
+static void *heap_tag(void *ptr, uintptr_t caller, size_t size)
+{
+    if (ptr != NULL) {
+        struct mem_block *block = (struct mem_block *)((uint8_t *)ptr - HEADER_SIZE);
+        block->caller = caller;
+        block->req_size = size;
+    }
+    return ptr;
+}
+#endif
+
+/*
+ * Clear a block's in-use bit and take it out of the usage counters
+ */
+static void block_mark_free(struct mem_block *block)
+{
+    block->size &= ~BLOCK_USED;
+    used_memory -= block_size(block);
+
+    int cls = size_to_class(block_size(block) - HEADER_SIZE);
+    class_stats[cls].used_blocks--;
+    class_stats[cls].used_bytes -= block_size(block) - HEADER_SIZE;
+}
+
+/*
+ * Return a block (size set, in-use bit clear) to the free lists,
+ * merging it with free neighbours
+ */
+static void block_release(struct mem_block *block)
+{
+    /*
+     * The merged block stays zeroed only if all parts were; the header
+     * and links of an absorbed block then have to be cleared as well.
+     */
+    bool zero = block_zeroed(block);
+
+    /* Coalesce with next block if it's free (a fence never is) */
+    struct mem_block *next = block_next(block);
+    if (!block_used(next)) {
+        free_list_remove(next);
+        zero = zero && block_zeroed(next);
+        block->size = block_size(block) + block_size(next);
+        if (zero) {
+            memset(next, 0, MIN_BLOCK_SIZE);
+        }
+    }
+
+    /* Coalesce with previous block if it's free */
+    struct mem_block *prev = block_prev(block);
+    if (prev != NULL && !block_used(prev)) {
+        free_list_remove(prev);
+        zero = zero && block_zeroed(prev);
+        prev->size = block_size(prev) + block_size(block);
+        if (zero) {
+            memset(block, 0, MIN_BLOCK_SIZE);
+        }
+        block = prev;
+    }
+
+    block->size = block_size(block) | (zero ? BLOCK_ZERO : 0);
+    block_next(block)->prev_size = block_size(block);
+    free_list_insert(block);
+}
+
+/*
+ * Add memory to the heap. Memory that starts exactly where a region
+ * ends extends that region (its fence becomes part of a free block);
+ * anything else becomes a new region. Fresh memory reads as zero (it
+ * comes from the demand-zero heap range).
+ */
+static bool heap_add_region(uint8_t *start, size_t size)
+{
+    struct mem_block *block = NULL;
+
+    for (int i = 0; i < region_count; i++) {
+        if (regions[i].end == start) {
+            /* Old fence becomes the header of the new free block */
+            block = (struct mem_block *)(start - HEADER_SIZE);
+            block->size = size | BLOCK_ZERO;
+            regions[i].end = start + size;
+            used_memory -= HEADER_SIZE;
+            break;
+        }
+    }
+
+    if (block == NULL) {
+        if (region_count == HEAP_MAX_REGIONS) {
+            return false;
+        }
+        regions[region_count].start = start;
+        regions[region_count].end = start + size;
+        region_count++;
+
+        block = (struct mem_block *)start;
+        block->size = (size - HEADER_SIZE) | BLOCK_ZERO;
+        block->prev_size = 0;
+    }
+
+    /* New fence at the end of the region */
+    struct mem_block *fence = block_next(block);
+    fence->size = HEADER_SIZE | BLOCK_USED;
+    fence->prev_size = block_size(block);
+
+    total_memory += size;
+    used_memory += HEADER_SIZE;
+
+    block_release(block);
+    return true;
+}
+
+/*
+ * Grow the heap so that a payload of the given size can be allocated
+ */
+static bool heap_grow(size_t payload)
+{
+    /* Block header plus the moved fence, rounded to whole growth steps */
+    size_t needed = payload + 2 * HEADER_SIZE;
+    size_t size = (needed + HEAP_GROW_SIZE - 1) & ~(size_t)(HEAP_GROW_SIZE - 1);
+    if (size < needed) {
+        return false;
+    }
+
+    size_t room = (uint8_t *)(HEAP_VIRT_BASE + HEAP_VIRT_SIZE) - heap_brk;
+    if (size > room) {
+        if (needed > room) {
+            return false;
+        }
+        size = room;
+    }
+
+    /* Don't promise more than the page allocator could back */
+    if ((size >> PAGE_SHIFT) > pmm_get_free_pages()) {
+        return false;
+    }
+
+    if (!heap_add_region(heap_brk, size)) {
+        return false;
+    }
+    heap_brk += size;
+    return true;
+}
 
 /*
  * Initialize the memory manager
  */
 void memory_init(void)
 {
-    /* Initialize heap with a single free block */
-    heap_start = (struct mem_block *)HEAP_START;
-    heap_start->size = HEAP_SIZE;
-    heap_start->used = false;
-    heap_start->next = NULL;
+    for (int i = 0; i < MEM_NUM_CLASSES; i++) {
+        free_lists[i] = NULL;
+        class_stats[i].free_blocks = 0;
+        class_stats[i].free_bytes = 0;
+        class_stats[i].used_blocks = 0;
+        class_stats[i].used_bytes = 0;
+        dirty_blocks[i] = 0;
+    }
+    free_bitmap = 0;
+    zero_cursor = NULL;
+    idle_zeroed_bytes = 0;
+    shrinker_count = 0;
+    reclaiming = false;
 
-    total_memory = HEAP_SIZE;
+    region_count = 0;
+    total_memory = 0;
     used_memory = 0;
+    peak_used = 0;
+
+    /* Only the first and last page are touched here */
+    heap_brk = (uint8_t *)HEAP_VIRT_BASE;
+    if (heap_add_region(heap_brk, HEAP_INITIAL_SIZE)) {
+        heap_brk += HEAP_INITIAL_SIZE;
+    }
 }
 
 /*
- * Allocate memory
+ * Find a free block for a payload, growing the heap and then asking
+ * the shrinkers for memory (in priority order) before giving up
  */
-void *kmalloc(size_t size)
+static struct mem_block *heap_find_block(int cls, size_t payload)
 {
-    if (size == 0) {
+    struct mem_block *block = find_free_block(cls, payload);
+    if (block == NULL && heap_grow(payload)) {
+        block = find_free_block(cls, payload);
+    }
+    if (block != NULL || reclaiming) {
+        return block;
+    }
+
+    reclaiming = true;
+    for (int i = 0; i < shrinker_count && block == NULL; i++) {
+        size_t freed = shrinkers[i].fn(payload + HEADER_SIZE);
+        shrinkers[i].calls++;
+        shrinkers[i].reclaimed += freed;
+        if (freed != 0) {
+            block = find_free_block(cls, payload);
+        }
+    }
+    reclaiming = false;
+
+    return block;
+}
+
+/*
+ * Allocate a block for a (rounded) payload of class cls, reporting
+ * whether it came pre-zeroed (all but the first MIN_PAYLOAD bytes)
+ */
+static void *heap_alloc_class(int cls, size_t size, bool *zeroed)
+{
+    struct mem_block *block = heap_find_block(cls, size);
+    if (block == NULL) {
+        /* No suitable block found */
+        return NULL;
+    }
+
+    if (zeroed != NULL) {
+        *zeroed = block_zeroed(block);
+    }
+    return block_allocate(block, size + HEADER_SIZE);
+}
+
+/*
+ * Allocate a block for a payload of size bytes
+ */
+static void *heap_alloc(size_t size, bool *zeroed)
+{
+    if (size == 0 || size > KMALLOC_MAX_SIZE) {
         return NULL;
     }
 
     /* Align size to 8 bytes */
     size = (size + 7) & ~7;
+    if (size < MIN_PAYLOAD) {
+        size = MIN_PAYLOAD;
+    }
 
-    /* Total size including header */
-    size_t total_size = size + sizeof(struct mem_block);
+    return heap_alloc_class(size_to_class(size), size, zeroed);
+}
 
-    /* Find a free block that fits */
-    struct mem_block *block = heap_start;
-    while (block != NULL) {
-        if (!block->used && block->size >= total_size) {
-            /* Found a suitable block */
+/*
+ * Allocate memory (generic path, see kmalloc() in memory.h)
+ */
+void *__kmalloc(size_t size)
+{
+    return HEAP_TAG(heap_alloc(size, NULL), size);
+}
 
-            /* Split the block if it's much larger than needed */
-            if (block->size >= total_size + sizeof(struct mem_block) + 16) {
-                struct mem_block *new_block = (struct mem_block *)((uint8_t *)block + total_size);
-                new_block->size = block->size - total_size;
-                new_block->used = false;
-                new_block->next = block->next;
+/*
+ * Allocate memory whose size class was resolved at compile time
+ */
+void *kmalloc_class(int cls, size_t payload)
+{
+    return HEAP_TAG(heap_alloc_class(cls, payload, NULL), payload);
+}
 
-                block->size = total_size;
-                block->next = new_block;
-            }
+/*
+ * Allocate a block whose payload is aligned to align (a power of two).
+ * A large enough block is carved so that the gap in front of the
+ * aligned payload goes back to the free lists as a block of its own.
+ */
+static void *heap_alloc_aligned(size_t size, size_t align)
+{
+    if (size == 0 || size > KMALLOC_MAX_SIZE || (align & (align - 1)) != 0) {
+        return NULL;
+    }
+    if (align <= 8) {
+        return heap_alloc(size, NULL);
+    }
+    if (align > KMALLOC_MAX_SIZE) {
+        return NULL;
+    }
+
+    size = (size + 7) & ~7;
+    if (size < MIN_PAYLOAD) {
+        size = MIN_PAYLOAD;
+    }
+
+    /* Room for the payload plus the worst-case alignment gap */
+    size_t search = size + align + MIN_BLOCK_SIZE;
+    if (search > KMALLOC_MAX_SIZE) {
+        return NULL;
+    }
+    struct mem_block *block = heap_find_block(size_to_class(search), search);
+    if (block == NULL) {
+        return NULL;
+    }
+
+    /* First aligned payload that leaves a usable block in front */
+    uintptr_t payload = (uintptr_t)block + HEADER_SIZE;
+    uintptr_t aligned = (payload + align - 1) & ~(uintptr_t)(align - 1);
+    if (aligned != payload && aligned - payload < MIN_BLOCK_SIZE) {
+        aligned += align;
+    }
 
-            block->used = true;
-            used_memory += block->size;
+    /* Give the gap in front back to the free lists */
+    if (aligned != payload) {
+        struct mem_block *aligned_block = (struct mem_block *)(aligned - HEADER_SIZE);
+        size_t front = (uint8_t *)aligned_block - (uint8_t *)block;
 
-            /* Return pointer to usable memory (after header) */
-            return (void *)((uint8_t *)block + sizeof(struct mem_block));
+        aligned_block->size = (block_size(block) - front) | (block->size & BLOCK_ZERO);
+        aligned_block->prev_size = front;
+        block_next(aligned_block)->prev_size = block_size(aligned_block);
+
+        block->size = front | (block->size & BLOCK_ZERO);
+        free_list_insert(block);
+        block = aligned_block;
+    }
+
+    return block_allocate(block, size + HEADER_SIZE);
+}
+
+/*
+ * Allocate memory aligned to align bytes (a power of two), released
+ * with kfree(). The block is only virtually contiguous; use dma_alloc()
+ * for memory a device has to see.
+ */
+void *kmalloc_aligned(size_t size, size_t align)
+{
+    return HEAP_TAG(heap_alloc_aligned(size, align), size);
+}
+
+/*
+ * Allocate a page-sized, page-aligned block (backing store for slabs).
+ * The result is an ordinary heap block and is released with kfree().
+ */
+void *kmalloc_page(void)
+{
+    return HEAP_TAG(heap_alloc_aligned(PAGE_SIZE, PAGE_SIZE), PAGE_SIZE);
+}
+
+/*
+ * Allocate a buffer for ISA DMA: physically contiguous, below 16MB and
+ * not crossing a 64KB boundary. It comes straight from the page
+ * allocator's DMA zone, whose blocks are naturally aligned, so any
+ * block of up to 64KB satisfies all three. The memory is identity
+ * mapped; the returned pointer is also the physical address.
+ */
+void *dma_alloc(size_t size)
+{
+    if (size == 0 || size > DMA_MAX_SIZE) {
+        return NULL;
+    }
+    return (void *)pmm_alloc_pages_zone(pmm_size_to_order(size), PMM_ZONE_DMA);
+}
+
+/*
+ * Free a DMA buffer (size as passed to dma_alloc)
+ */
+void dma_free(void *ptr, size_t size)
+{
+    if (ptr == NULL || size == 0 || size > DMA_MAX_SIZE) {
+        return;
+    }
+    pmm_free_pages((uintptr_t)ptr, pmm_size_to_order(size));
+}
+
+/*
+ * Carve up to count used blocks of total_size bytes from the front of
+ * a free (unlinked) block, storing their payloads in out. A remainder
+ * too small to stand alone is absorbed by the last block.
+ */
+static size_t block_carve(struct mem_block *block, size_t total_size, size_t count, void **out)
+{
+    size_t size = block_size(block);
+    size_t zero = block->size & BLOCK_ZERO;
+    size_t prev_size = block->prev_size;
+
+    if (count > size / total_size) {
+        count = size / total_size;
+    }
+    size_t rest = size - count * total_size;
+
+    uint8_t *pos = (uint8_t *)block;
+    for (size_t i = 0; i < count; i++) {
+        struct mem_block *b = (struct mem_block *)pos;
+        size_t this_size = total_size;
+        if (i == count - 1 && rest < MIN_BLOCK_SIZE) {
+            this_size += rest;
+            rest = 0;
         }
-        block = block->next;
+
+        b->size = this_size | BLOCK_USED;
+        b->prev_size = prev_size;
+        prev_size = this_size;
+
+        int cls = size_to_class(this_size - HEADER_SIZE);
+        class_stats[cls].used_blocks++;
+        class_stats[cls].used_bytes += this_size - HEADER_SIZE;
+
+        out[i] = pos + HEADER_SIZE;
+        pos += this_size;
+    }
+
+    /* The tail keeps the original block's zero state */
+    if (rest != 0) {
+        struct mem_block *tail = (struct mem_block *)pos;
+        tail->size = rest | zero;
+        tail->prev_size = prev_size;
+        block_next(tail)->prev_size = rest;
+        free_list_insert(tail);
+    } else {
+        ((struct mem_block *)pos)->prev_size = prev_size;
+    }
+
+    used_memory += size - rest;
+    if (used_memory > peak_used) {
+        peak_used = used_memory;
+    }
+    return count;
+}
+
+/*
+ * Allocate count objects of the same size, storing them in out.
+ * Exact-fit blocks are used first; the rest are carved back to back
+ * out of as few free blocks as possible, so a batch costs one free
+ * list search per block used rather than one per object. Returns the
+ * number of objects allocated (fewer than count when out of memory).
+ */
+size_t kmalloc_bulk(size_t size, size_t count, void **out)
+{
+    if (size == 0 || size > KMALLOC_MAX_SIZE || out == NULL) {
+        return 0;
+    }
+
+    size_t payload = (size + 7) & ~7;
+    if (payload < MIN_PAYLOAD) {
+        payload = MIN_PAYLOAD;
+    }
+    size_t total_size = payload + HEADER_SIZE;
+    int cls = size_to_class(payload);
+    size_t done = 0;
+
+    /* Blocks on an exact list fit perfectly; take those first */
+    while (cls < EXACT_CLASSES && done < count && free_lists[cls] != NULL) {
+        struct mem_block *block = free_lists[cls];
+        free_list_remove(block);
+        out[done++] = block_allocate(block, total_size);
+    }
+
+    while (done < count) {
+        struct mem_block *block = NULL;
+
+        /* One block for everything that is left, if there is one */
+        size_t left = count - done;
+        if (left > 1 && left <= KMALLOC_MAX_SIZE / total_size) {
+            size_t span = left * total_size - HEADER_SIZE;
+            block = find_free_block(size_to_class(span), span);
+            if (block == NULL && heap_grow(span)) {
+                block = find_free_block(size_to_class(span), span);
+            }
+        }
+
+        /* Otherwise whatever block fits the next object */
+        if (block == NULL) {
+            block = heap_find_block(cls, payload);
+            if (block == NULL) {
+                break;
+            }
+        }
+
+        done += block_carve(block, total_size, left, out + done);
     }
 
-    /* No suitable block found */
-    return NULL;
+#ifdef HEAP_TAGS
+    for (size_t i = 0; i < done; i++) {
+        HEAP_TAG(out[i], size);
+    }
+#endif
+    return done;
 }
 
 /*
@@ -88,14 +784,20 @@ void *kmalloc(size_t size)
  */
 void *kcalloc(size_t num, size_t size)
 {
+    if (size != 0 && num > KMALLOC_MAX_SIZE / size) {
+        return NULL;
+    }
+
     size_t total = num * size;
-    void *ptr = kmalloc(total);
+    bool zeroed = false;
+    void *ptr = heap_alloc(total, &zeroed);
 
+    /* Pre-zeroed blocks only need their free list links cleared */
     if (ptr != NULL) {
-        memset(ptr, 0, total);
+        memset(ptr, 0, zeroed ? MIN_PAYLOAD : total);
     }
 
-    return ptr;
+    return HEAP_TAG(ptr, total);
 }
 
 /*
@@ -108,31 +810,78 @@ void kfree(void *ptr)
     }
 
     /* Get block header */
-    struct mem_block *block = (struct mem_block *)((uint8_t *)ptr - sizeof(struct mem_block));
+    struct mem_block *block = (struct mem_block *)((uint8_t *)ptr - HEADER_SIZE);
 
-    if (!block->used) {
+    if (!block_used(block)) {
         /* Double free! */
         return;
     }
 
-    block->used = false;
-    used_memory -= block->size;
+    block_mark_free(block);
+    block_release(block);
+}
+
+/*
+ * Free a batch of pointers. Runs of blocks that lie back to back in
+ * memory (as kmalloc_bulk hands them out) are merged before they go
+ * back to the free lists, so each run costs a single release.
+ */
+void kfree_bulk(void **ptrs, size_t count)
+{
+    if (ptrs == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        if (ptrs[i] == NULL) {
+            continue;
+        }
+
+        struct mem_block *block = (struct mem_block *)((uint8_t *)ptrs[i] - HEADER_SIZE);
+        if (!block_used(block)) {
+            /* Double free! */
+            continue;
+        }
+        block_mark_free(block);
+
+        /* Absorb the following pointers while they are the next block */
+        while (i + 1 < count && ptrs[i + 1] != NULL) {
+            struct mem_block *next = (struct mem_block *)((uint8_t *)ptrs[i + 1] - HEADER_SIZE);
+            if (next != block_next(block) || !block_used(next)) {
+                break;
+            }
+            block_mark_free(next);
+            block->size += block_size(next);
+            i++;
+        }
 
-    /* Coalesce with next block if it's free */
-    if (block->next != NULL && !block->next->used) {
-        block->size += block->next->size;
-        block->next = block->next->next;
+        block_release(block);
     }
+}
 
-    /* Coalesce with previous block if it's free */
-    struct mem_block *prev = heap_start;
-    while (prev != NULL && prev->next != block) {
-        prev = prev->next;
+/*
+ * Resize a used block in place to total_size bytes. Growing absorbs the
+ * next block if it is free and large enough; shrinking hands the tail
+ * back to the free lists (merged with a free next block).
+ */
+static bool block_resize(struct mem_block *block, size_t total_size)
+{
+    size_t size = block_size(block);
+    struct mem_block *next = block_next(block);
+
+    if (total_size > size && (block_used(next) || size + block_size(next) < total_size)) {
+        return false;
     }
-    if (prev != NULL && !prev->used) {
-        prev->size += block->size;
-        prev->next = block->next;
+
+    block_mark_free(block);
+    if (!block_used(next)) {
+        free_list_remove(next);
+        block->size += block_size(next);
+        block_next(block)->prev_size = block_size(block);
     }
+
+    block_allocate(block, total_size);
+    return true;
 }
 
 /*
@@ -141,7 +890,7 @@ void kfree(void *ptr)
 void *krealloc(void *ptr, size_t size)
 {
     if (ptr == NULL) {
-        return kmalloc(size);
+        return HEAP_TAG(kmalloc(size), size);
     }
 
     if (size == 0) {
@@ -149,13 +898,23 @@ void *krealloc(void *ptr, size_t size)
         return NULL;
     }
 
-    /* Get old block */
-    struct mem_block *old_block = (struct mem_block *)((uint8_t *)ptr - sizeof(struct mem_block));
-    size_t old_size = old_block->size - sizeof(struct mem_block);
+    if (size > KMALLOC_MAX_SIZE) {
+        return NULL;
+    }
+    size_t requested = size;
 
-    /* If new size fits in current block, just return */
-    if (size <= old_size) {
-        return ptr;
+    /* Same rounding as kmalloc */
+    size = (size + 7) & ~7;
+    if (size < MIN_PAYLOAD) {
+        size = MIN_PAYLOAD;
+    }
+
+    /* Grow or shrink in place when the neighbourhood allows it */
+    struct mem_block *old_block = (struct mem_block *)((uint8_t *)ptr - HEADER_SIZE);
+    size_t old_size = block_size(old_block) - HEADER_SIZE;
+
+    if (block_resize(old_block, size + HEADER_SIZE)) {
+        return HEAP_TAG(ptr, requested);
     }
 
     /* Allocate new block */
@@ -170,7 +929,125 @@ void *krealloc(void *ptr, size_t size)
     /* Free old block */
     kfree(ptr);
 
-    return new_ptr;
+    return HEAP_TAG(new_ptr, requested);
+}
+
+/*
+ * Register a callback that releases memory when an allocation would
+ * otherwise fail. Lower priorities are asked first.
+ */
+bool memory_register_shrinker(const char *name, int priority, shrinker_fn_t fn)
+{
+    if (fn == NULL || shrinker_count >= MAX_SHRINKERS) {
+        return false;
+    }
+
+    /* Insert after shrinkers of the same priority */
+    int pos = shrinker_count;
+    while (pos > 0 && shrinkers[pos - 1].priority > priority) {
+        shrinkers[pos] = shrinkers[pos - 1];
+        pos--;
+    }
+
+    shrinkers[pos].name = name;
+    shrinkers[pos].priority = priority;
+    shrinkers[pos].fn = fn;
+    shrinkers[pos].calls = 0;
+    shrinkers[pos].reclaimed = 0;
+    shrinker_count++;
+    return true;
+}
+
+/*
+ * Remove a shrinker
+ */
+void memory_unregister_shrinker(shrinker_fn_t fn)
+{
+    for (int i = 0; i < shrinker_count; i++) {
+        if (shrinkers[i].fn == fn) {
+            for (int j = i; j < shrinker_count - 1; j++) {
+                shrinkers[j] = shrinkers[j + 1];
+            }
+            shrinker_count--;
+            return;
+        }
+    }
+}
+
+/*
+ * Get statistics for the shrinker at position index (in call order)
+ */
+int memory_get_shrinker_stats(int index, struct mem_shrinker_stats *stats)
+{
+    if (index < 0 || index >= shrinker_count || stats == NULL) {
+        return -1;
+    }
+
+    stats->name = shrinkers[index].name;
+    stats->priority = shrinkers[index].priority;
+    stats->calls = shrinkers[index].calls;
+    stats->reclaimed = shrinkers[index].reclaimed;
+    return 0;
+}
+
+/*
+ * Background work for the idle loop: zero a piece of a dirty free
+ * block. Returns false if every candidate block is already zeroed.
+ */
+bool memory_idle(void)
+{
+    if (zero_cursor == NULL) {
+        /* Pick a dirty block, largest classes first */
+        for (int cls = MEM_NUM_CLASSES - 1; cls >= EXACT_CLASSES && zero_cursor == NULL; cls--) {
+            if (dirty_blocks[cls] == 0) {
+                continue;
+            }
+            for (struct mem_block *block = free_lists[cls]; block != NULL;
+                 block = block_links(block)->next_free) {
+                if (!block_zeroed(block)) {
+                    zero_cursor = block;
+                    zero_offset = MIN_BLOCK_SIZE;
+                    break;
+                }
+            }
+        }
+        if (zero_cursor == NULL) {
+            return false;
+        }
+    }
+
+    /*
+     * Work page by page. Pages the heap never touched are still zero,
+     * so they only need to be skipped (and stay uncommitted).
+     */
+    size_t end = block_size(zero_cursor);
+    size_t zeroed = 0;
+    int skipped = 0;
+    while (zero_offset < end && zeroed < IDLE_ZERO_BYTES && skipped < IDLE_SKIP_PAGES) {
+        uintptr_t addr = (uintptr_t)zero_cursor + zero_offset;
+        size_t chunk = PAGE_SIZE - (addr & (PAGE_SIZE - 1));
+        if (chunk > end - zero_offset) {
+            chunk = end - zero_offset;
+        }
+
+        if (paging_is_committed(addr)) {
+            memset((void *)addr, 0, chunk);
+            zeroed += chunk;
+        } else {
+            skipped++;
+        }
+        zero_offset += chunk;
+    }
+    idle_zeroed_bytes += zeroed;
+
+    if (zero_offset == end) {
+        int cls = size_to_class(end - HEADER_SIZE);
+        zero_cursor->size |= BLOCK_ZERO;
+        dirty_blocks[cls]--;
+        zero_cursor = NULL;
+    }
+
+    return true;
 }
 
 /*
@@ -198,72 +1075,218 @@ size_t memory_get_free(void)
 }
 
 /*
- * Memory copy
+ * Check heap consistency: boundary tags, coalescing and free lists.
+ * Returns 0 if the heap is sound, -1 otherwise.
  */
-void *memcpy(void *dest, const void *src, size_t n)
+int memory_check(void)
 {
-    uint8_t *d = (uint8_t *)dest;
-    const uint8_t *s = (const uint8_t *)src;
+    size_t used = 0;
+    size_t free_blocks = 0;
+    struct mem_block *block;
+
+    for (int i = 0; i < region_count; i++) {
+        struct mem_block *fence = (struct mem_block *)(regions[i].end - HEADER_SIZE);
+        size_t prev_size = 0;
+        bool prev_free = false;
+
+        /* Walk the blocks in address order */
+        block = (struct mem_block *)regions[i].start;
+        while (block != fence) {
+            size_t size = block_size(block);
+            if (size < MIN_BLOCK_SIZE || (uint8_t *)block + size > (uint8_t *)fence) {
+                return -1;
+            }
+            if (block->prev_size != prev_size) {
+                return -1;
+            }
+
+            if (block_used(block)) {
+                used += size;
+                prev_free = false;
+            } else {
+                if (prev_free) {
+                    return -1;  /* Two adjacent free blocks: missed a merge */
+                }
+                prev_free = true;
+                free_blocks++;
+            }
+
+            prev_size = size;
+            block = block_next(block);
+        }
+
+        if (fence->prev_size != prev_size || fence->size != (HEADER_SIZE | BLOCK_USED)) {
+            return -1;
+        }
+        used += HEADER_SIZE;
+    }
+
+    if (used != used_memory) {
+        return -1;
+    }
 
-    while (n--) {
-        *d++ = *s++;
+    /* Every free list entry must be a free block of the right class */
+    size_t listed = 0;
+    for (int cls = 0; cls < MEM_NUM_CLASSES; cls++) {
+        for (block = free_lists[cls]; block != NULL; block = block_links(block)->next_free) {
+            if (block_used(block) || size_to_class(block_size(block) - HEADER_SIZE) != cls) {
+                return -1;
+            }
+            listed++;
+        }
     }
 
-    return dest;
+    return listed == free_blocks ? 0 : -1;
+}
+
+/*
+ * Get the number of heap regions
+ */
+int memory_get_region_count(void)
+{
+    return region_count;
 }
 
 /*
- * Memory set
+ * Get occupancy of a size class (returns -1 for an invalid class)
  */
-void *memset(void *s, int c, size_t n)
+int memory_get_class_stats(int cls, struct mem_class_stats *stats)
 {
-    uint8_t *p = (uint8_t *)s;
+    if (cls < 0 || cls >= MEM_NUM_CLASSES || stats == NULL) {
+        return -1;
+    }
+
+    *stats = class_stats[cls];
 
-    while (n--) {
-        *p++ = (uint8_t)c;
+    /* Fill in the payload range the class covers */
+    if (cls < EXACT_CLASSES) {
+        stats->min_size = (size_t)(cls + 1) * 8;
+        stats->max_size = stats->min_size;
+    } else {
+        stats->min_size = ((size_t)1 << (cls - 9)) + 8;
+        stats->max_size = (cls == MEM_NUM_CLASSES - 1) ? 0 : (size_t)1 << (cls - 8);
     }
 
-    return s;
+    return 0;
 }
 
 /*
- * Memory compare
+ * Summarize the shape of the heap
  */
-int memcmp(const void *s1, const void *s2, size_t n)
+void memory_get_heap_info(struct mem_heap_info *info)
 {
-    const uint8_t *p1 = (const uint8_t *)s1;
-    const uint8_t *p2 = (const uint8_t *)s2;
+    size_t free_bytes = 0;
+    size_t free_blocks = 0;
+    size_t zeroed_bytes = 0;
+    for (int i = 0; i < MEM_NUM_CLASSES; i++) {
+        free_bytes += class_stats[i].free_bytes;
+        free_blocks += class_stats[i].free_blocks;
+
+        if (dirty_blocks[i] == class_stats[i].free_blocks) {
+            continue;
+        }
+        for (struct mem_block *block = free_lists[i]; block != NULL;
+             block = block_links(block)->next_free) {
+            if (block_zeroed(block)) {
+                zeroed_bytes += block_size(block) - HEADER_SIZE;
+            }
+        }
+    }
 
-    while (n--) {
-        if (*p1 != *p2) {
-            return *p1 - *p2;
+    /* The largest free block is on the highest non-empty list */
+    size_t largest = 0;
+    if (free_bitmap != 0) {
+        struct mem_block *block = free_lists[31 - __builtin_clz(free_bitmap)];
+        while (block != NULL) {
+            if (block_size(block) - HEADER_SIZE > largest) {
+                largest = block_size(block) - HEADER_SIZE;
+            }
+            block = block_links(block)->next_free;
         }
-        p1++;
-        p2++;
     }
 
-    return 0;
+    info->free_bytes = free_bytes;
+    info->free_blocks = free_blocks;
+    info->largest_free = largest;
+    info->peak_used = peak_used;
+    info->zeroed_bytes = zeroed_bytes;
+    info->idle_zeroed = idle_zeroed_bytes;
+
+    /* Share of free memory that a single big request cannot use */
+    info->fragmentation = 0;
+    if (free_bytes >= 100) {
+        size_t percent = largest / (free_bytes / 100);
+        info->fragmentation = (percent < 100) ? 100 - percent : 0;
+    }
 }
 
 /*
- * Memory move (handles overlapping regions)
+ * Group live allocations by call site and return the biggest ones
+ * (by requested bytes), or -1 if the kernel was built without HEAP_TAGS
  */
-void *memmove(void *dest, const void *src, size_t n)
+int memory_get_top_sites(struct mem_site_stats *sites, int max)
 {
-    uint8_t *d = (uint8_t *)dest;
-    const uint8_t *s = (const uint8_t *)src;
+#ifdef HEAP_TAGS
+    static struct mem_site_stats table[MAX_CALL_SITES + 1];
+    int count = 0;
+    size_t other_blocks = 0;
+    size_t other_bytes = 0;
+
+    for (int i = 0; i < region_count; i++) {
+        struct mem_block *fence = (struct mem_block *)(regions[i].end - HEADER_SIZE);
+        for (struct mem_block *block = (struct mem_block *)regions[i].start;
+             block != fence; block = block_next(block)) {
+            if (!block_used(block)) {
+                continue;
+            }
 
-    if (d < s) {
-        while (n--) {
-            *d++ = *s++;
+            int j = 0;
+            while (j < count && table[j].caller != block->caller) {
+                j++;
+            }
+            if (j == count) {
+                if (count == MAX_CALL_SITES) {
+                    other_blocks++;
+                    other_bytes += block->req_size;
+                    continue;
+                }
+                table[count].caller = block->caller;
+                table[count].blocks = 0;
+                table[count].bytes = 0;
+                count++;
+            }
+            table[j].blocks++;
+            table[j].bytes += block->req_size;
         }
-    } else {
-        d += n;
-        s += n;
-        while (n--) {
-            *--d = *--s;
+    }
+
+    /* Sites beyond the table are lumped together under caller 0 */
+    if (other_blocks != 0) {
+        table[count].caller = 0;
+        table[count].blocks = other_blocks;
+        table[count].bytes = other_bytes;
+        count++;
+    }
+
+    /* Partial selection sort: only the first max entries matter */
+    int n = (count < max) ? count : max;
+    for (int i = 0; i < n; i++) {
+        int best = i;
+        for (int j = i + 1; j < count; j++) {
+            if (table[j].bytes > table[best].bytes) {
+                best = j;
+            }
         }
+        struct mem_site_stats tmp = table[i];
+        table[i] = table[best];
+        table[best] = tmp;
+        sites[i] = table[i];
     }
 
-    return dest;
+    return n;
+#else
+    (void)sites;
+    (void)max;
+    return -1;
+#endif
 }
@@ -7,21 +7,144 @@
 
 #include "../include/types.h"
 
-/* Initialize memory manager */
+/* Page size */
+#define PAGE_SIZE       4096
+#define PAGE_SHIFT      12
+
+/* Number of kmalloc size classes */
+#define MEM_NUM_CLASSES 32
+
+/* Largest kmalloc request */
+#define KMALLOC_MAX_SIZE    0x40000000
+
+/*
+ * Size class mapping as constant expressions (see memory.c): payloads
+ * are rounded up to a multiple of 8 and to at least KMALLOC_MIN_PAYLOAD;
+ * classes up to KMALLOC_EXACT_MAX hold one exact size each, larger ones
+ * are power-of-two ranges.
+ */
+#define KMALLOC_MIN_PAYLOAD 8
+#define KMALLOC_EXACT_MAX   128
+
+#define KMALLOC_PAYLOAD(size) \
+    ((size) < KMALLOC_MIN_PAYLOAD ? (size_t)KMALLOC_MIN_PAYLOAD : ((size_t)(size) + 7) & ~(size_t)7)
+
+#define KMALLOC_LOG2_CLASS(payload) ((32 - __builtin_clz((uint32_t)(payload) - 1)) + 8)
+
+#define KMALLOC_CLASS(payload) \
+    ((payload) <= KMALLOC_EXACT_MAX ? (int)((payload) >> 3) - 1 : \
+     KMALLOC_LOG2_CLASS(payload) < MEM_NUM_CLASSES ? KMALLOC_LOG2_CLASS(payload) : MEM_NUM_CLASSES - 1)
+
+/* Per-size-class occupancy */
+struct mem_class_stats {
+    size_t min_size;        /* Smallest payload in this class */
+    size_t max_size;        /* Largest payload (0 = unbounded) */
+    size_t free_blocks;     /* Blocks on the class free list */
+    size_t free_bytes;
+    size_t used_blocks;     /* Live allocations in this class */
+    size_t used_bytes;
+};
+
+/* Initialize memory manager (needs paging_init first) */
 void memory_init(void);
 
 /* Memory allocation */
-void *kmalloc(size_t size);
+void *__kmalloc(size_t size);
+void *kmalloc_class(int cls, size_t payload);
+
+/*
+ * kmalloc front end: a constant size is rounded and mapped to its size
+ * class at compile time, so the call goes straight to that free list.
+ * This has to be a macro: the kernel is built without optimization,
+ * where __builtin_constant_p never sees through an inline function's
+ * parameters. The size expression is evaluated exactly once.
+ */
+#define kmalloc(size) \
+    (__builtin_constant_p(size) && (size) != 0 && (size) <= KMALLOC_MAX_SIZE \
+         ? kmalloc_class(KMALLOC_CLASS(KMALLOC_PAYLOAD(size)), KMALLOC_PAYLOAD(size)) \
+         : __kmalloc(size))
 void *kcalloc(size_t num, size_t size);
 void *krealloc(void *ptr, size_t size);
 void kfree(void *ptr);
 
+/* Batches of equally sized objects (kmalloc_bulk returns how many it got) */
+size_t kmalloc_bulk(size_t size, size_t count, void **out);
+void kfree_bulk(void **ptrs, size_t count);
+
+void *kmalloc_aligned(size_t size, size_t align);
+void *kmalloc_page(void);
+
+/*
+ * ISA DMA buffers: physically contiguous, below 16MB, never crossing a
+ * 64KB boundary, and identity mapped (pointer == physical address).
+ */
+#define DMA_MAX_SIZE    0x10000
+
+void *dma_alloc(size_t size);
+void dma_free(void *ptr, size_t size);
+
 /* Memory statistics */
 size_t memory_get_total(void);
 size_t memory_get_used(void);
 size_t memory_get_free(void);
+int memory_get_region_count(void);
+int memory_get_class_stats(int cls, struct mem_class_stats *stats);
+
+/*
+ * Memory pressure callbacks. Before an allocation fails, each shrinker
+ * in turn is asked to release about wanted bytes back to the heap and
+ * returns how much it actually freed. Shrinkers may kfree() but must
+ * not expect kmalloc() to reclaim on their behalf.
+ */
+typedef size_t (*shrinker_fn_t)(size_t wanted);
+
+/* Priorities: cheap-to-rebuild caches go first */
+#define SHRINK_PRIO_CACHE   0
+#define SHRINK_PRIO_BUFFER  10
+
+struct mem_shrinker_stats {
+    const char *name;
+    int priority;
+    uint32_t calls;
+    size_t reclaimed;           /* Bytes released so far */
+};
+
+bool memory_register_shrinker(const char *name, int priority, shrinker_fn_t fn);
+void memory_unregister_shrinker(shrinker_fn_t fn);
+
+/* Statistics (index-based walk in call order; -1 past the end) */
+int memory_get_shrinker_stats(int index, struct mem_shrinker_stats *stats);
+
+/* Idle-time housekeeping, returns false when there is nothing to do */
+bool memory_idle(void);
+
+/* Heap shape summary */
+struct mem_heap_info {
+    size_t free_bytes;          /* Free payload bytes */
+    size_t free_blocks;
+    size_t largest_free;        /* Largest free payload */
+    size_t peak_used;           /* High-water mark of used memory */
+    size_t zeroed_bytes;        /* Free bytes known to be zero */
+    size_t idle_zeroed;         /* Bytes cleared by the idle loop so far */
+    unsigned int fragmentation; /* % of free bytes outside the largest block */
+};
+
+void memory_get_heap_info(struct mem_heap_info *info);
+
+/* Live allocations of one call site (HEAP_TAGS builds) */
+struct mem_site_stats {
+    uintptr_t caller;           /* 0 = all sites that didn't fit the table */
+    size_t blocks;
+    size_t bytes;               /* Requested bytes */
+};
+
+/* Top call sites by live bytes, -1 without HEAP_TAGS */
+int memory_get_top_sites(struct mem_site_stats *sites, int max);
+
+/* Heap consistency check (0 = OK) */
+int memory_check(void);
 
-/* Memory manipulation */
+/* Memory manipulation (memops.c) */
 void *memcpy(void *dest, const void *src, size_t n);
 void *memset(void *s, int c, size_t n);
 int memcmp(const void *s1, const void *s2, size_t n);
@@ -0,0 +1,203 @@
+/*
+ * KontolOS Memory Pool
+ *
+ * Each pool owns one heap block carved into fixed-size slots. Free
+ * slots form a stack linked through their first word. The stack head
+ * is a pointer plus a generation tag, swapped as one 64-bit value with
+ * cmpxchg8b. An interrupt handler can pop and push the very slot the
+ * interrupted code was looking at; the tag changes with every update,
+ * so the interrupted compare-and-swap fails and retries instead of
+ * installing a stale next pointer (the ABA problem).
+ *
+ * The pool's memory is written once at creation, so every page behind
+ * it is committed before the pool is used: a handler must never take
+ * a demand-paging fault, which would allocate page frames.
+ */
+
+#include "mempool.h"
+#include "memory.h"
+#include "kernel.h"
+
+/* Stack head: top free slot and a tag bumped on every update */
+union pool_head {
+    uint64_t raw;
+    struct {
+        void *top;
+        uint32_t tag;
+    };
+};
+
+struct mempool {
+    volatile union pool_head head __attribute__((aligned(8)));
+    uint8_t *base;              /* First slot */
+    uint8_t *end;               /* Past the last slot */
+    size_t slot_size;
+    const char *name;
+    size_t object_size;
+    size_t capacity;
+
+    /* Statistics, updated atomically */
+    volatile uint32_t available;
+    volatile uint32_t low_water;    /* Approximate under nested updates */
+    volatile uint32_t allocs;
+    volatile uint32_t frees;
+    volatile uint32_t exhausted;
+
+    struct mempool *next_pool;
+};
+
+/* All pools, for statistics */
+static struct mempool *pool_list = NULL;
+
+/*
+ * Create a pool of count objects of the given size
+ */
+struct mempool *mempool_create(const char *name, size_t size, size_t count)
+{
+    if (size == 0 || count == 0) {
+        return NULL;
+    }
+
+    /* Free slots hold the next-free pointer */
+    size_t slot = (size < sizeof(void *)) ? sizeof(void *) : size;
+    slot = (slot + 7) & ~(size_t)7;
+    if (count > KMALLOC_MAX_SIZE / slot) {
+        return NULL;
+    }
+
+    struct mempool *pool = kmalloc(sizeof(struct mempool));
+    if (pool == NULL) {
+        return NULL;
+    }
+    pool->base = kmalloc(slot * count);
+    if (pool->base == NULL) {
+        kfree(pool);
+        return NULL;
+    }
+
+    /* Touch every page now; handlers must not fault them in */
+    memset(pool->base, 0, slot * count);
+
+    pool->end = pool->base + slot * count;
+    pool->slot_size = slot;
+    pool->name = name;
+    pool->object_size = size;
+    pool->capacity = count;
+
+    /* Chain the slots in address order */
+    void *top = NULL;
+    for (size_t i = count; i > 0; i--) {
+        void *obj = pool->base + (i - 1) * slot;
+        *(void **)obj = top;
+        top = obj;
+    }
+    pool->head.top = top;
+    pool->head.tag = 0;
+
+    pool->available = (uint32_t)count;
+    pool->low_water = (uint32_t)count;
+    pool->allocs = 0;
+    pool->frees = 0;
+    pool->exhausted = 0;
+
+    pool->next_pool = pool_list;
+    pool_list = pool;
+
+    return pool;
+}
+
+/*
+ * Destroy a pool (outstanding objects become invalid)
+ */
+void mempool_destroy(struct mempool *pool)
+{
+    if (pool == NULL) {
+        return;
+    }
+
+    struct mempool **link = &pool_list;
+    while (*link != NULL && *link != pool) {
+        link = &(*link)->next_pool;
+    }
+    if (*link != NULL) {
+        *link = pool->next_pool;
+    }
+
+    kfree(pool->base);
+    kfree(pool);
+}
+
+/*
+ * Take an object from a pool
+ */
+void *mempool_alloc(struct mempool *pool)
+{
+    union pool_head old, new;
+
+    old.raw = pool->head.raw;
+    do {
+        if (old.top == NULL) {
+            atomic_add(&pool->exhausted, 1);
+            return NULL;
+        }
+        /* old.top may be stale here; the swap then fails and retries */
+        new.top = *(void * volatile *)old.top;
+        new.tag = old.tag + 1;
+    } while (!cmpxchg64(&pool->head.raw, &old.raw, new.raw));
+
+    uint32_t available = atomic_add(&pool->available, (uint32_t)-1) - 1;
+    if (available < pool->low_water) {
+        pool->low_water = available;
+    }
+    atomic_add(&pool->allocs, 1);
+    return old.top;
+}
+
+/*
+ * Return an object to its pool
+ */
+void mempool_free(struct mempool *pool, void *obj)
+{
+    uint8_t *ptr = obj;
+    if (ptr == NULL || ptr < pool->base || ptr >= pool->end ||
+        (size_t)(ptr - pool->base) % pool->slot_size != 0) {
+        return;     /* Not from this pool */
+    }
+
+    union pool_head old, new;
+
+    old.raw = pool->head.raw;
+    do {
+        *(void * volatile *)obj = old.top;
+        new.top = obj;
+        new.tag = old.tag + 1;
+    } while (!cmpxchg64(&pool->head.raw, &old.raw, new.raw));
+
+    atomic_add(&pool->available, 1);
+    atomic_add(&pool->frees, 1);
+}
+
+/*
+ * Get statistics for the pool at position index
+ */
+int mempool_get_stats(int index, struct mempool_stats *stats)
+{
+    struct mempool *pool = pool_list;
+    while (pool != NULL && index-- > 0) {
+        pool = pool->next_pool;
+    }
+
+    if (pool == NULL || stats == NULL) {
+        return -1;
+    }
+
+    stats->name = pool->name;
+    stats->object_size = pool->object_size;
+    stats->capacity = pool->capacity;
+    stats->available = pool->available;
+    stats->low_water = pool->low_water;
+    stats->allocs = pool->allocs;
+    stats->frees = pool->frees;
+    stats->exhausted = pool->exhausted;
+    return 0;
+}
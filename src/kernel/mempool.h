@@ -0,0 +1,41 @@
+/*
+ * KontolOS Memory Pool Header
+ *
+ * A mempool is a fixed number of equally sized objects reserved up
+ * front. Allocation and release are lock-free and never touch the
+ * heap, so they are safe in interrupt handlers without masking
+ * interrupts. Creating and destroying pools is not.
+ */
+
+#ifndef MEMPOOL_H
+#define MEMPOOL_H
+
+#include "../include/types.h"
+
+/* Opaque pool handle */
+struct mempool;
+
+/* Per-pool statistics */
+struct mempool_stats {
+    const char *name;
+    size_t object_size;     /* Requested object size */
+    size_t capacity;        /* Objects reserved */
+    size_t available;       /* Objects currently free */
+    size_t low_water;       /* Fewest objects ever free */
+    uint32_t allocs;
+    uint32_t frees;
+    uint32_t exhausted;     /* Allocations that found the pool empty */
+};
+
+/* Pool management (process context only) */
+struct mempool *mempool_create(const char *name, size_t size, size_t count);
+void mempool_destroy(struct mempool *pool);
+
+/* Object allocation (any context; NULL when the pool is empty) */
+void *mempool_alloc(struct mempool *pool);
+void mempool_free(struct mempool *pool, void *obj);
+
+/* Statistics (index-based walk over all pools; -1 past the end) */
+int mempool_get_stats(int index, struct mempool_stats *stats);
+
+#endif /* MEMPOOL_H */
@@ -0,0 +1,227 @@
+/*
+ * KontolOS Paging
+ *
+ * Physical memory is identity-mapped, with 4MB pages when the CPU
+ * supports PSE and 4KB page tables otherwise. So is the VBE
+ * framebuffer, which usually sits far above RAM. The heap lives in a
+ * separate virtual range whose pages are committed on demand: the first
+ * access to a page faults, and the fault handler maps a freshly zeroed
+ * page frame in its place.
+ */
+
+#include "paging.h"
+#include "kernel.h"
+#include "memory.h"
+#include "pmm.h"
+#include "cpu.h"
+
+#define PAGE_ENTRIES        1024
+#define LARGE_PAGE_SIZE     0x400000
+#define PAGE_FRAME_MASK     (~(uint32_t)(PAGE_SIZE - 1))
+
+/* Minimum identity-mapped range (covers the low MB and early devices) */
+#define IDENTITY_MIN_END    0x1000000
+
+/* CR0 / CR4 bits */
+#define CR0_WP              (1u << 16)
+#define CR0_PG              (1u << 31)
+#define CR4_PSE             (1u << 4)
+#define CR4_PGE             (1u << 7)
+
+/* Kernel page directory */
+static uint32_t page_directory[PAGE_ENTRIES] __attribute__((aligned(PAGE_SIZE)));
+
+static bool large_pages = false;
+static size_t committed_pages = 0;
+static size_t fault_count = 0;
+
+/*
+ * Zero a page frame without touching the XMM registers
+ *
+ * This runs in the page fault handler, which can interrupt an SSE2
+ * memcpy/memset on a heap page it has not touched yet (see memops.c).
+ * Going through memset would clobber that loop's XMM state.
+ */
+static void clear_frame(uintptr_t frame)
+{
+    void *dest = (void *)frame;
+    size_t count = PAGE_SIZE / 4;
+    __asm__ volatile("rep stosl" : "+D"(dest), "+c"(count) : "a"(0) : "memory");
+}
+
+/*
+ * Get the page table covering a virtual address, allocating an empty
+ * one if needed. Page tables are reached through the identity map.
+ */
+static uint32_t *get_page_table(uintptr_t virt, bool create)
+{
+    uint32_t *pde = &page_directory[virt >> 22];
+
+    if (!(*pde & PTE_PRESENT)) {
+        if (!create) {
+            return NULL;
+        }
+        uintptr_t table = pmm_alloc_pages(0);
+        if (table == 0) {
+            return NULL;
+        }
+        clear_frame(table);
+        *pde = table | PTE_PRESENT | PTE_WRITE;
+    }
+
+    return (uint32_t *)(*pde & PAGE_FRAME_MASK);
+}
+
+/*
+ * Identity-map [base, base + size) with the given page flags, in whole
+ * 4MB chunks
+ */
+static bool identity_map(uintptr_t base, size_t size, uint32_t flags)
+{
+    uintptr_t addr = base & ~(uintptr_t)(LARGE_PAGE_SIZE - 1);
+    size_t chunks = (size + (base - addr) + LARGE_PAGE_SIZE - 1) / LARGE_PAGE_SIZE;
+
+    for (; chunks > 0; chunks--, addr += LARGE_PAGE_SIZE) {
+        if (large_pages) {
+            page_directory[addr >> 22] = addr | flags | PTE_LARGE;
+            continue;
+        }
+
+        uint32_t *table = get_page_table(addr, true);
+        if (table == NULL) {
+            return false;
+        }
+        for (int i = 0; i < PAGE_ENTRIES; i++) {
+            table[i] = (addr + (uintptr_t)i * PAGE_SIZE) | flags;
+        }
+    }
+
+    return true;
+}
+
+/*
+ * Initialize paging
+ */
+void paging_init(struct boot_info *boot_info)
+{
+    for (int i = 0; i < PAGE_ENTRIES; i++) {
+        page_directory[i] = 0;
+    }
+
+    large_pages = cpu_has(CPU_FEATURE_PSE);
+
+    uint32_t cr4 = read_cr4();
+    if (large_pages) {
+        cr4 |= CR4_PSE;
+    }
+    if (cpu_has(CPU_FEATURE_PGE)) {
+        cr4 |= CR4_PGE;
+    }
+    write_cr4(cr4);
+
+    /* Identity map all managed RAM, rounded up to whole 4MB chunks */
+    uintptr_t end = pmm_get_max_address();
+    if (end < IDENTITY_MIN_END) {
+        end = IDENTITY_MIN_END;
+    }
+    end = (end + LARGE_PAGE_SIZE - 1) & ~(uintptr_t)(LARGE_PAGE_SIZE - 1);
+
+    uint32_t flags = PTE_PRESENT | PTE_WRITE;
+    if (cpu_has(CPU_FEATURE_PGE)) {
+        flags |= PTE_GLOBAL;
+    }
+    if (!identity_map(0, end, flags)) {
+        kernel_panic("Out of memory for page tables");
+    }
+
+    /* The framebuffer, unless it collides with the heap range */
+    if (boot_info != NULL && boot_info->magic == BOOT_INFO_MAGIC && boot_info->fb_addr != 0) {
+        uintptr_t fb = boot_info->fb_addr;
+        size_t fb_size = boot_info->fb_pitch * boot_info->fb_height;
+        if ((fb + fb_size <= HEAP_VIRT_BASE || fb >= HEAP_VIRT_BASE + HEAP_VIRT_SIZE) &&
+            !identity_map(fb, fb_size, flags)) {
+            kernel_panic("Out of memory for page tables");
+        }
+    }
+
+    /* The heap range starts out completely unmapped */
+    write_cr3((uint32_t)page_directory);
+    write_cr0(read_cr0() | CR0_PG | CR0_WP);
+}
+
+/*
+ * Back one heap page with a zeroed page frame
+ */
+static bool commit_page(uintptr_t virt)
+{
+    uint32_t *table = get_page_table(virt, true);
+    if (table == NULL) {
+        return false;
+    }
+
+    uint32_t *pte = &table[(virt >> PAGE_SHIFT) & (PAGE_ENTRIES - 1)];
+    if (!(*pte & PTE_PRESENT)) {
+        uintptr_t frame = pmm_alloc_pages(0);
+        if (frame == 0) {
+            return false;
+        }
+        clear_frame(frame);
+        *pte = frame | PTE_PRESENT | PTE_WRITE;
+        committed_pages++;
+    }
+
+    invlpg(virt);
+    return true;
+}
+
+/*
+ * Page fault handler
+ *
+ * Only not-present faults inside the heap range are resolved; anything
+ * else is a genuine bug and is left to the exception handler.
+ */
+bool paging_handle_fault(struct interrupt_frame *frame)
+{
+    uintptr_t addr = read_cr2();
+
+    if (frame->err_code & PF_PRESENT) {
+        return false;
+    }
+    if (addr < HEAP_VIRT_BASE || addr - HEAP_VIRT_BASE >= HEAP_VIRT_SIZE) {
+        return false;
+    }
+
+    fault_count++;
+    return commit_page(addr & PAGE_FRAME_MASK);
+}
+
+/*
+ * Check whether a heap page is backed by a page frame yet
+ * (untouched pages read as zero once they are)
+ */
+bool paging_is_committed(uintptr_t virt)
+{
+    uint32_t *table = get_page_table(virt, false);
+    if (table == NULL) {
+        return false;
+    }
+    return (table[(virt >> PAGE_SHIFT) & (PAGE_ENTRIES - 1)] & PTE_PRESENT) != 0;
+}
+
+/*
+ * Statistics
+ */
+bool paging_uses_large_pages(void)
+{
+    return large_pages;
+}
+
+size_t paging_get_committed_pages(void)
+{
+    return committed_pages;
+}
+
+size_t paging_get_fault_count(void)
+{
+    return fault_count;
+}
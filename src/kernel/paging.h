@@ -0,0 +1,46 @@
+/*
+ * KontolOS Paging Header
+ */
+
+#ifndef PAGING_H
+#define PAGING_H
+
+#include "../include/types.h"
+#include "idt.h"
+#include "bootinfo.h"
+
+/* Page table entry flags */
+#define PTE_PRESENT     0x001
+#define PTE_WRITE       0x002
+#define PTE_USER        0x004
+#define PTE_LARGE       0x080   /* 4MB page (page directory entries, PSE) */
+#define PTE_GLOBAL      0x100
+
+/* Page fault error code bits */
+#define PF_PRESENT      0x01    /* Protection violation (page was present) */
+#define PF_WRITE        0x02
+#define PF_USER         0x04
+
+/*
+ * Virtual range reserved for the kernel heap. Pages in it are backed
+ * by a physical frame only once they are first touched.
+ */
+#define HEAP_VIRT_BASE  0xD0000000
+#define HEAP_VIRT_SIZE  0x10000000  /* 256MB */
+
+/* Build the page directory and enable paging (needs pmm_init first);
+ * also maps the framebuffer described in the boot info */
+void paging_init(struct boot_info *boot_info);
+
+/* Page fault handler, returns false if the fault cannot be resolved */
+bool paging_handle_fault(struct interrupt_frame *frame);
+
+/* Is a heap page backed by a page frame yet? */
+bool paging_is_committed(uintptr_t virt);
+
+/* Statistics */
+bool paging_uses_large_pages(void);
+size_t paging_get_committed_pages(void);
+size_t paging_get_fault_count(void);
+
+#endif /* PAGING_H */
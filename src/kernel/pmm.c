@@ -0,0 +1,322 @@
+/*
+ * KontolOS Physical Memory Manager
+ *
+ * Binary buddy allocator over the RAM reported by the BIOS E820 map.
+ * Blocks are 2^order pages, naturally aligned; a freed block merges
+ * with its buddy (address ^ block size) whenever that buddy is free.
+ * Free blocks are linked through their own first bytes, and a byte per
+ * page records whether the page heads a free block and of which order.
+ *
+ * Only memory above the kernel image is managed; everything below 1MB
+ * (IVT, BIOS data, boot info, stack, VGA) is left alone.
+ *
+ * Frames below 16MB form a separate DMA zone with its own free lists,
+ * so ISA DMA buffers can still be found after the rest of memory has
+ * been handed out. The zone boundary is a multiple of the largest block
+ * size, so buddies never straddle it. Ordinary allocations only fall
+ * back to the DMA zone once the normal zone is exhausted.
+ */
+
+#include "pmm.h"
+#include "memory.h"
+
+/* End of the kernel image (from linker.ld) */
+extern char __kernel_end[];
+
+/* Fallback when the BIOS gave us no memory map: the old fixed layout */
+#define FALLBACK_RAM_END    0x600000
+
+/* page_info flags: low bits hold the order of a block head */
+#define PAGE_FREE           0x80
+#define PAGE_ORDER_MASK     0x0F
+
+/* Free list node, stored in the first bytes of a free block */
+struct free_area {
+    struct free_area *next;
+    struct free_area *prev;
+};
+
+/* First page frame of the normal zone */
+#define DMA_ZONE_PFN        (PMM_DMA_LIMIT / PAGE_SIZE)
+
+/* Per-zone, per-order free lists */
+static struct free_area *free_areas[PMM_NUM_ZONES][PMM_MAX_ORDER + 1];
+static size_t free_blocks[PMM_NUM_ZONES][PMM_MAX_ORDER + 1];
+
+/* One byte of state per page frame below max_pfn */
+static uint8_t *page_info = NULL;
+static size_t max_pfn = 0;
+
+/* Statistics */
+static size_t total_pages = 0;
+static size_t free_pages = 0;
+static size_t zone_free_pages[PMM_NUM_ZONES];
+
+/* Memory map */
+static const struct e820_entry *memory_map = NULL;
+static size_t memory_map_count = 0;
+
+/*
+ * Zone a page frame belongs to
+ */
+static inline int pfn_zone(size_t pfn)
+{
+    return (pfn < DMA_ZONE_PFN) ? PMM_ZONE_DMA : PMM_ZONE_NORMAL;
+}
+
+/*
+ * Free list helpers
+ */
+static void area_add(unsigned int order, size_t pfn)
+{
+    struct free_area *area = (struct free_area *)(pfn * PAGE_SIZE);
+    int zone = pfn_zone(pfn);
+
+    area->prev = NULL;
+    area->next = free_areas[zone][order];
+    if (free_areas[zone][order] != NULL) {
+        free_areas[zone][order]->prev = area;
+    }
+    free_areas[zone][order] = area;
+    free_blocks[zone][order]++;
+
+    page_info[pfn] = PAGE_FREE | order;
+}
+
+static void area_remove(unsigned int order, size_t pfn)
+{
+    struct free_area *area = (struct free_area *)(pfn * PAGE_SIZE);
+    int zone = pfn_zone(pfn);
+
+    if (area->prev != NULL) {
+        area->prev->next = area->next;
+    } else {
+        free_areas[zone][order] = area->next;
+    }
+    if (area->next != NULL) {
+        area->next->prev = area->prev;
+    }
+    free_blocks[zone][order]--;
+
+    page_info[pfn] = (uint8_t)order;
+}
+
+/*
+ * Hand a range of page frames [start, end) to the buddy allocator
+ */
+static void pmm_add_range(size_t start, size_t end)
+{
+    while (start < end) {
+        /* Largest naturally aligned block that fits */
+        unsigned int order = PMM_MAX_ORDER;
+        while (order > 0 && ((start & ((1u << order) - 1)) || start + (1u << order) > end)) {
+            order--;
+        }
+
+        total_pages += 1u << order;
+        pmm_free_pages(start * PAGE_SIZE, order);
+        start += 1u << order;
+    }
+}
+
+/*
+ * Initialize the physical memory manager
+ */
+void pmm_init(struct boot_info *boot_info)
+{
+    static const struct e820_entry fallback_map[] = {
+        { 0x100000, FALLBACK_RAM_END - 0x100000, E820_RAM, 1 },
+    };
+
+    if (boot_info != NULL && boot_info->magic == BOOT_INFO_MAGIC && boot_info->mmap_count > 0) {
+        memory_map = boot_info->mmap;
+        memory_map_count = boot_info->mmap_count;
+    } else {
+        memory_map = fallback_map;
+        memory_map_count = 1;
+    }
+
+    for (int zone = 0; zone < PMM_NUM_ZONES; zone++) {
+        for (int i = 0; i <= PMM_MAX_ORDER; i++) {
+            free_areas[zone][i] = NULL;
+            free_blocks[zone][i] = 0;
+        }
+        zone_free_pages[zone] = 0;
+    }
+
+    /* Highest usable page frame (identity-mapped memory only) */
+    max_pfn = 0;
+    for (size_t i = 0; i < memory_map_count; i++) {
+        const struct e820_entry *entry = &memory_map[i];
+        if (entry->type != E820_RAM || entry->base >= PMM_PHYS_LIMIT) {
+            continue;
+        }
+        uint64_t end = entry->base + entry->length;
+        if (end > PMM_PHYS_LIMIT) {
+            end = PMM_PHYS_LIMIT;
+        }
+        if ((size_t)(end >> PAGE_SHIFT) > max_pfn) {
+            max_pfn = (size_t)(end >> PAGE_SHIFT);
+        }
+    }
+
+    /* Page state table goes right after the kernel image */
+    uintptr_t kernel_end = ((uintptr_t)__kernel_end + PAGE_SIZE - 1) & ~(uintptr_t)(PAGE_SIZE - 1);
+    page_info = (uint8_t *)kernel_end;
+    memset(page_info, 0, max_pfn);
+
+    size_t first_free_pfn = (kernel_end + max_pfn + PAGE_SIZE - 1) / PAGE_SIZE;
+
+    /* Release every RAM range above the kernel and the page table */
+    for (size_t i = 0; i < memory_map_count; i++) {
+        const struct e820_entry *entry = &memory_map[i];
+        if (entry->type != E820_RAM || entry->base >= PMM_PHYS_LIMIT) {
+            continue;
+        }
+
+        uint64_t end = entry->base + entry->length;
+        if (end > PMM_PHYS_LIMIT) {
+            end = PMM_PHYS_LIMIT;
+        }
+
+        /* Round inwards to whole pages */
+        size_t start_pfn = (size_t)((entry->base + PAGE_SIZE - 1) >> PAGE_SHIFT);
+        size_t end_pfn = (size_t)(end >> PAGE_SHIFT);
+
+        if (start_pfn < first_free_pfn) {
+            start_pfn = first_free_pfn;
+        }
+        if (start_pfn < end_pfn) {
+            pmm_add_range(start_pfn, end_pfn);
+        }
+    }
+}
+
+/*
+ * Allocate 2^order contiguous, naturally aligned page frames from a zone
+ */
+uintptr_t pmm_alloc_pages_zone(unsigned int order, int zone)
+{
+    if (order > PMM_MAX_ORDER || zone < 0 || zone >= PMM_NUM_ZONES) {
+        return 0;
+    }
+
+    /* Smallest order with a free block */
+    unsigned int current = order;
+    while (current <= PMM_MAX_ORDER && free_areas[zone][current] == NULL) {
+        current++;
+    }
+    if (current > PMM_MAX_ORDER) {
+        return 0;
+    }
+
+    size_t pfn = (uintptr_t)free_areas[zone][current] / PAGE_SIZE;
+    area_remove(current, pfn);
+
+    /* Split, returning the upper halves to the free lists */
+    while (current > order) {
+        current--;
+        area_add(current, pfn + (1u << current));
+    }
+
+    page_info[pfn] = (uint8_t)order;
+    free_pages -= 1u << order;
+    zone_free_pages[zone] -= 1u << order;
+    return pfn * PAGE_SIZE;
+}
+
+/*
+ * Allocate 2^order contiguous, naturally aligned page frames,
+ * sparing the DMA zone while normal memory lasts
+ */
+uintptr_t pmm_alloc_pages(unsigned int order)
+{
+    uintptr_t addr = pmm_alloc_pages_zone(order, PMM_ZONE_NORMAL);
+    if (addr == 0) {
+        addr = pmm_alloc_pages_zone(order, PMM_ZONE_DMA);
+    }
+    return addr;
+}
+
+/*
+ * Free 2^order page frames, merging with free buddies
+ */
+void pmm_free_pages(uintptr_t addr, unsigned int order)
+{
+    if (addr == 0 || order > PMM_MAX_ORDER) {
+        return;
+    }
+
+    size_t pfn = addr / PAGE_SIZE;
+    free_pages += 1u << order;
+    zone_free_pages[pfn_zone(pfn)] += 1u << order;
+
+    while (order < PMM_MAX_ORDER) {
+        size_t buddy = pfn ^ (1u << order);
+        if (buddy >= max_pfn || page_info[buddy] != (PAGE_FREE | order)) {
+            break;
+        }
+        area_remove(order, buddy);
+        pfn &= ~(size_t)(1u << order);
+        order++;
+    }
+
+    area_add(order, pfn);
+}
+
+/*
+ * Smallest order whose block holds size bytes
+ */
+unsigned int pmm_size_to_order(size_t size)
+{
+    unsigned int order = 0;
+    while (order < PMM_MAX_ORDER && ((size_t)PAGE_SIZE << order) < size) {
+        order++;
+    }
+    return order;
+}
+
+/*
+ * Get the end of managed physical memory
+ */
+uintptr_t pmm_get_max_address(void)
+{
+    return (uintptr_t)max_pfn << PAGE_SHIFT;
+}
+
+/*
+ * Statistics
+ */
+size_t pmm_get_total_pages(void)
+{
+    return total_pages;
+}
+
+size_t pmm_get_free_pages(void)
+{
+    return free_pages;
+}
+
+size_t pmm_get_free_blocks(unsigned int order)
+{
+    if (order > PMM_MAX_ORDER) {
+        return 0;
+    }
+    return free_blocks[PMM_ZONE_DMA][order] + free_blocks[PMM_ZONE_NORMAL][order];
+}
+
+size_t pmm_get_zone_free_pages(int zone)
+{
+    return (zone >= 0 && zone < PMM_NUM_ZONES) ? zone_free_pages[zone] : 0;
+}
+
+/*
+ * Get the memory map
+ */
+size_t pmm_get_memory_map(const struct e820_entry **entries)
+{
+    if (entries != NULL) {
+        *entries = memory_map;
+    }
+    return memory_map_count;
+}
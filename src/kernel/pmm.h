@@ -0,0 +1,52 @@
+/*
+ * KontolOS Physical Memory Manager Header
+ */
+
+#ifndef PMM_H
+#define PMM_H
+
+#include "../include/types.h"
+#include "bootinfo.h"
+
+/* Largest buddy block: 2^PMM_MAX_ORDER pages (4MB) */
+#define PMM_MAX_ORDER   10
+
+/*
+ * Only RAM below this address is managed. Everything under it is
+ * identity-mapped; the virtual space above holds the heap.
+ */
+#define PMM_PHYS_LIMIT  0xC0000000ULL
+
+/*
+ * Memory zones. ISA DMA can only reach the first 16MB, so frames below
+ * PMM_DMA_LIMIT are kept apart and used for normal allocations last.
+ */
+#define PMM_DMA_LIMIT   0x1000000
+#define PMM_ZONE_DMA    0
+#define PMM_ZONE_NORMAL 1
+#define PMM_NUM_ZONES   2
+
+/* Initialize from the boot memory map (NULL = fixed fallback layout) */
+void pmm_init(struct boot_info *boot_info);
+
+/* Page frame allocation (physical addresses, 0 on failure) */
+uintptr_t pmm_alloc_pages(unsigned int order);
+uintptr_t pmm_alloc_pages_zone(unsigned int order, int zone);
+void pmm_free_pages(uintptr_t addr, unsigned int order);
+
+/* Smallest order whose block holds the given number of bytes */
+unsigned int pmm_size_to_order(size_t size);
+
+/* End of the highest managed page frame */
+uintptr_t pmm_get_max_address(void);
+
+/* Statistics (in pages) */
+size_t pmm_get_total_pages(void);
+size_t pmm_get_free_pages(void);
+size_t pmm_get_free_blocks(unsigned int order);
+size_t pmm_get_zone_free_pages(int zone);
+
+/* Memory map as reported by the BIOS (returns entry count) */
+size_t pmm_get_memory_map(const struct e820_entry **entries);
+
+#endif /* PMM_H */
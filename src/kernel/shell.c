@@ -9,17 +9,43 @@
 #include "timer.h"
 #include "memory.h"
 #include "string.h"
+#include "printf.h"
+#include "checksum.h"
+#include "cpu.h"
+#include "bench.h"
+#include "slab.h"
+#include "mempool.h"
+#include "arena.h"
+#include "pmm.h"
+#include "paging.h"
 #include "../fs/ramfs.h"
 
 /* Shell constants */
 #define SHELL_BUFFER_SIZE   256
 #define MAX_ARGS            16
+#define SHELL_STACK_SIZE    16384   /* Per session */
 
 /* Shell prompt */
 static const char *shell_prompt = "kontol> ";
 
-/* Command buffer */
-static char command_buffer[SHELL_BUFFER_SIZE];
+/*
+ * One shell per virtual console, each on its own stack. The main loop
+ * resumes a session when its console has input, and the session runs
+ * until it waits for keys again, at the prompt or inside a command, so
+ * a command blocked on one console never holds up another. Commands
+ * that poll for keys without blocking keep the CPU until they return.
+ */
+struct shell_session {
+    uint32_t esp;           /* Saved stack pointer while switched out */
+    bool started;
+    struct arena *arena;    /* Scratch memory for the session's commands */
+};
+
+static struct shell_session sessions[VGA_NUM_CONSOLES];
+
+/* Main loop's stack pointer while a session runs, and that session */
+static uint32_t shell_loop_esp;
+static int current_session;
 
 /* Command structure */
 struct shell_command {
@@ -35,6 +61,9 @@ static void cmd_echo(int argc, char *argv[]);
 static void cmd_info(int argc, char *argv[]);
 static void cmd_uptime(int argc, char *argv[]);
 static void cmd_memory(int argc, char *argv[]);
+static void cmd_slabinfo(int argc, char *argv[]);
+static void cmd_heapstat(int argc, char *argv[]);
+static void cmd_memmap(int argc, char *argv[]);
 static void cmd_reboot(int argc, char *argv[]);
 static void cmd_halt(int argc, char *argv[]);
 static void cmd_shutdown(int argc, char *argv[]);
@@ -42,6 +71,7 @@ static void cmd_version(int argc, char *argv[]);
 static void cmd_color(int argc, char *argv[]);
 static void cmd_ls(int argc, char *argv[]);
 static void cmd_cat(int argc, char *argv[]);
+static void cmd_sum(int argc, char *argv[]);
 static void cmd_touch(int argc, char *argv[]);
 static void cmd_rm(int argc, char *argv[]);
 static void cmd_nano(int argc, char *argv[]);
@@ -58,6 +88,9 @@ static struct shell_command commands[] = {
     { "info",    "Display system information",       cmd_info },
     { "uptime",  "Show system uptime",               cmd_uptime },
     { "memory",  "Display memory statistics",        cmd_memory },
+    { "slabinfo","Display slab cache and pool stats", cmd_slabinfo },
+    { "heapstat","Display heap profile",             cmd_heapstat },
+    { "memmap",  "Display the BIOS memory map",      cmd_memmap },
     { "reboot",  "Reboot the system",                cmd_reboot },
     { "halt",    "Halt the system",                  cmd_halt },
     { "shutdown","Power off the system",             cmd_shutdown },
@@ -65,6 +98,7 @@ static struct shell_command commands[] = {
     { "color",   "Change text color (0-15)",         cmd_color },
     { "ls",      "List files",                        cmd_ls },
     { "cat",     "Display file contents",             cmd_cat },
+    { "sum",     "Checksum a file (CRC32C, xxHash32)", cmd_sum },
     { "touch",   "Create empty file",                 cmd_touch },
     { "rm",      "Remove file",                       cmd_rm },
     { "nano",    "Edit file",                         cmd_nano },
@@ -72,15 +106,60 @@ static struct shell_command commands[] = {
     { "rmdir",   "Remove directory",                  cmd_rmdir },
     { "cd",      "Change directory",                  cmd_cd },
     { "pwd",     "Print working directory",           cmd_pwd },
+    { "bench",   "Run kernel benchmarks",             bench_run },
     { NULL, NULL, NULL }
 };
 
+/* nano line buffers come from their own slab cache */
+#define NANO_MAX_LINES  100
+#define NANO_LINE_LEN   80
+#define NANO_VIEW_ROWS  22      /* Text rows between title and status bar */
+
+static struct kmem_cache *nano_line_cache = NULL;
+
+/*
+ * Scratch memory for the running command (its session's arena).
+ * Everything allocated from it is released in one go when the command
+ * returns.
+ */
+static struct arena *command_arena = NULL;
+
+static void shell_wait(int console);
+static void shell_session_main(void);
+
 /*
  * Initialize the shell
  */
 void shell_init(void)
 {
-    /* Nothing to initialize for now */
+    nano_line_cache = kmem_cache_create("nano_line", NANO_LINE_LEN, 0, 0, NULL);
+
+    for (int i = 0; i < VGA_NUM_CONSOLES; i++) {
+        /*
+         * Touch the whole stack now: heap pages are only backed once
+         * used, and a fault while the CPU pushes an exception frame onto
+         * an unbacked stack page would be a double fault.
+         */
+        uint32_t *stack = kmalloc(SHELL_STACK_SIZE);
+        if (stack == NULL) {
+            kernel_panic("Out of memory for shell stacks");
+        }
+        memset(stack, 0, SHELL_STACK_SIZE);
+
+        /* Initial frame for context_switch: four registers, then the
+         * entry point to return into (shell_session_main never returns) */
+        uint32_t *top = stack + SHELL_STACK_SIZE / sizeof(uint32_t);
+        *--top = 0;
+        *--top = (uint32_t)shell_session_main;
+        top -= 4;
+
+        sessions[i].esp = (uint32_t)top;
+        sessions[i].started = false;
+        sessions[i].arena = arena_create(ARENA_CHUNK_SIZE);
+    }
+
+    current_session = -1;
+    keyboard_set_console_handler(shell_wait);
 }
 
 /*
@@ -134,6 +213,7 @@ static void execute_command(char *line)
     for (int i = 0; commands[i].name != NULL; i++) {
         if (strcmp(argv[0], commands[i].name) == 0) {
             commands[i].handler(argc, argv);
+            arena_reset(command_arena);
             return;
         }
     }
@@ -147,21 +227,107 @@ static void execute_command(char *line)
 }
 
 /*
- * Run the shell main loop
+ * Print a decimal number right-aligned in a field of the given width
  */
-void shell_run(void)
+static void print_padded_dec(uint32_t value, int width)
 {
-    while (1) {
-        /* Print prompt */
+    kprintf("%*u", width, value);
+}
+
+/*
+ * Print a decimal number left-aligned in a field of the given width
+ */
+static void print_dec_left(uint32_t value, int width)
+{
+    kprintf("%-*u", width, value);
+}
+
+/*
+ * Print a 64-bit value in hexadecimal
+ */
+static void print_hex64(uint64_t value)
+{
+    const char hex_chars[] = "0123456789ABCDEF";
+    char buffer[17];
+    int i = 16;
+
+    buffer[i] = '\0';
+    do {
+        buffer[--i] = hex_chars[value & 0xF];
+        value >>= 4;
+    } while (value != 0);
+
+    vga_print("0x");
+    vga_print(&buffer[i]);
+}
+
+/*
+ * Keyboard wait handler: switch from the waiting session back to the
+ * main loop, which resumes it once its console has input
+ */
+static void shell_wait(int console)
+{
+    (void)console;      /* Always the current session's console */
+
+    if (current_session < 0) {
+        kernel_idle();
+        return;
+    }
+
+    context_switch(&sessions[current_session].esp, shell_loop_esp);
+}
+
+/*
+ * Run a session until it waits for keys again
+ */
+static void shell_resume(int console)
+{
+    current_session = console;
+    vga_set_console(console);
+    command_arena = sessions[console].arena;
+
+    context_switch(&shell_loop_esp, sessions[console].esp);
+
+    current_session = -1;
+}
+
+/*
+ * A session's shell: read a line, run the command, repeat
+ */
+static void shell_session_main(void)
+{
+    sessions[current_session].started = true;
+
+    char line[SHELL_BUFFER_SIZE];
+    for (;;) {
         vga_set_color(VGA_COLOR_LIGHT_GREEN, VGA_COLOR_BLACK);
         vga_print(shell_prompt);
         vga_set_color(VGA_COLOR_WHITE, VGA_COLOR_BLACK);
 
-        /* Read command */
-        keyboard_readline(command_buffer, SHELL_BUFFER_SIZE);
+        keyboard_readline(line, sizeof(line));
+        execute_command(line);
+    }
+}
+
+/*
+ * Run the shell main loop
+ */
+void shell_run(void)
+{
+    while (1) {
+        bool ran = false;
+        for (int i = 0; i < VGA_NUM_CONSOLES; i++) {
+            vga_set_console(i);
+            if (!sessions[i].started || keyboard_has_key()) {
+                shell_resume(i);
+                ran = true;
+            }
+        }
 
-        /* Execute command */
-        execute_command(command_buffer);
+        vga_set_console(vga_get_foreground());
+        if (!ran) {
+            kernel_idle();
+        }
     }
 }
 
@@ -180,14 +346,9 @@ static void cmd_help(int argc, char *argv[])
 
     for (int i = 0; commands[i].name != NULL; i++) {
         vga_set_color(VGA_COLOR_LIGHT_GREEN, VGA_COLOR_BLACK);
-        vga_print("  ");
-        vga_print(commands[i].name);
-        vga_set_color(VGA_COLOR_DARK_GREY, VGA_COLOR_BLACK);
         /* Pad to align descriptions */
-        int len = strlen(commands[i].name);
-        for (int j = len; j < 10; j++) {
-            vga_putchar(' ');
-        }
+        kprintf("  %-10s", commands[i].name);
+        vga_set_color(VGA_COLOR_DARK_GREY, VGA_COLOR_BLACK);
         vga_print(" - ");
         vga_set_color(VGA_COLOR_LIGHT_GREY, VGA_COLOR_BLACK);
         vga_print(commands[i].description);
@@ -291,23 +452,19 @@ static void cmd_memory(int argc, char *argv[])
     vga_print("\n=== Memory Statistics ===\n\n");
     vga_set_color(VGA_COLOR_WHITE, VGA_COLOR_BLACK);
 
-    vga_print("  Total:  ");
-    vga_print_dec(total / 1024);
-    vga_print(" KB (");
-    vga_print_dec(total);
-    vga_print(" bytes)\n");
+    kprintf("  Total:  %zu KB (%zu bytes)\n", total / 1024, total);
+    kprintf("  Used:   %zu KB (%zu bytes)\n", used / 1024, used);
+    kprintf("  Free:   %zu KB (%zu bytes)\n", free / 1024, free);
 
-    vga_print("  Used:   ");
-    vga_print_dec(used / 1024);
-    vga_print(" KB (");
-    vga_print_dec(used);
-    vga_print(" bytes)\n");
+    kprintf("  Heap regions: %d   Physical: %zu KB free of %zu KB (DMA zone: %zu KB free)\n",
+            memory_get_region_count(),
+            pmm_get_free_pages() * (PAGE_SIZE / 1024),
+            pmm_get_total_pages() * (PAGE_SIZE / 1024),
+            pmm_get_zone_free_pages(PMM_ZONE_DMA) * (PAGE_SIZE / 1024));
 
-    vga_print("  Free:   ");
-    vga_print_dec(free / 1024);
-    vga_print(" KB (");
-    vga_print_dec(free);
-    vga_print(" bytes)\n\n");
+    kprintf("  Heap pages committed: %zu KB (%zu faults)\n\n",
+            paging_get_committed_pages() * (PAGE_SIZE / 1024),
+            paging_get_fault_count());
 
     /* Show usage bar */
     int percent = (used * 100) / total;
@@ -320,9 +477,235 @@ static void cmd_memory(int argc, char *argv[])
     vga_set_color(VGA_COLOR_DARK_GREY, VGA_COLOR_BLACK);
     for (int i = filled; i < bar_width; i++) vga_putchar('-');
     vga_set_color(VGA_COLOR_WHITE, VGA_COLOR_BLACK);
-    vga_print("] ");
-    vga_print_dec(percent);
-    vga_print("%\n\n");
+    kprintf("] %d%%\n\n", percent);
+
+    /* Per-size-class occupancy (only classes that hold blocks) */
+    vga_set_color(VGA_COLOR_LIGHT_CYAN, VGA_COLOR_BLACK);
+    vga_print("  Class  Size range        Used blocks    Free blocks\n");
+    vga_set_color(VGA_COLOR_WHITE, VGA_COLOR_BLACK);
+
+    for (int cls = 0; cls < MEM_NUM_CLASSES; cls++) {
+        struct mem_class_stats stats;
+        memory_get_class_stats(cls, &stats);
+        if (stats.used_blocks == 0 && stats.free_blocks == 0) {
+            continue;
+        }
+
+        if (stats.min_size == stats.max_size) {
+            kprintf("  %5d  %16zu", cls, stats.max_size);
+        } else if (stats.max_size != 0) {
+            kprintf("  %5d  %7zu-%8zu", cls, stats.min_size, stats.max_size);
+        } else {
+            kprintf("  %5d  %7zu-     max", cls, stats.min_size);
+        }
+        kprintf("  %11zu    %11zu\n", stats.used_blocks, stats.free_blocks);
+    }
+    vga_print("\n");
+}
+
+/*
+ * Command: slabinfo
+ */
+static void cmd_slabinfo(int argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+
+    vga_set_color(VGA_COLOR_LIGHT_CYAN, VGA_COLOR_BLACK);
+    vga_print("\n=== Slab Caches ===\n\n");
+    vga_print("  Name           Size  Slot  Per slab  Slabs  Active/Total    Allocs\n");
+    vga_set_color(VGA_COLOR_WHITE, VGA_COLOR_BLACK);
+
+    struct kmem_cache_stats stats;
+    for (int i = 0; kmem_cache_get_stats(i, &stats) == 0; i++) {
+        vga_print("  ");
+        vga_print(stats.name);
+        for (int j = strlen(stats.name); j < 12; j++) {
+            vga_putchar(' ');
+        }
+        print_padded_dec(stats.object_size, 7);
+        print_padded_dec(stats.slot_size, 6);
+        print_padded_dec(stats.objects_per_slab, 10);
+        print_padded_dec(stats.slabs, 7);
+        print_padded_dec(stats.active_objects, 8);
+        vga_print("/");
+        print_dec_left(stats.total_objects, 5);
+        print_padded_dec(stats.allocs, 10);
+        vga_print("\n");
+    }
+
+    /* IRQ-safe pools: reserved objects, low-water mark, failed allocations */
+    struct mempool_stats pool;
+    if (mempool_get_stats(0, &pool) == 0) {
+        vga_set_color(VGA_COLOR_LIGHT_CYAN, VGA_COLOR_BLACK);
+        vga_print("\n  Pool           Size  Free/Total   Low    Allocs  Exhausted\n");
+        vga_set_color(VGA_COLOR_WHITE, VGA_COLOR_BLACK);
+    }
+    for (int i = 0; mempool_get_stats(i, &pool) == 0; i++) {
+        vga_print("  ");
+        vga_print(pool.name);
+        for (int j = strlen(pool.name); j < 12; j++) {
+            vga_putchar(' ');
+        }
+        print_padded_dec(pool.object_size, 7);
+        print_padded_dec(pool.available, 6);
+        vga_print("/");
+        print_dec_left(pool.capacity, 5);
+        print_padded_dec(pool.low_water, 6);
+        print_padded_dec(pool.allocs, 10);
+        print_padded_dec(pool.exhausted, 11);
+        vga_print("\n");
+    }
+    vga_print("\n");
+}
+
+/*
+ * Command: heapstat
+ */
+static void cmd_heapstat(int argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+
+    struct mem_heap_info info;
+    memory_get_heap_info(&info);
+
+    vga_set_color(VGA_COLOR_LIGHT_CYAN, VGA_COLOR_BLACK);
+    vga_print("\n=== Heap Profile ===\n\n");
+    vga_set_color(VGA_COLOR_WHITE, VGA_COLOR_BLACK);
+
+    vga_print("  Used: ");
+    vga_print_dec(memory_get_used() / 1024);
+    vga_print(" KB   Peak: ");
+    vga_print_dec(info.peak_used / 1024);
+    vga_print(" KB   Free: ");
+    vga_print_dec(info.free_bytes / 1024);
+    vga_print(" KB in ");
+    vga_print_dec(info.free_blocks);
+    vga_print(" blocks\n");
+    vga_print("  Largest free block: ");
+    vga_print_dec(info.largest_free / 1024);
+    vga_print(" KB   Fragmentation: ");
+    vga_print_dec(info.fragmentation);
+    vga_print("%\n");
+    vga_print("  Pre-zeroed free: ");
+    vga_print_dec(info.zeroed_bytes / 1024);
+    vga_print(" KB   Zeroed while idle: ");
+    vga_print_dec(info.idle_zeroed / 1024);
+    vga_print(" KB\n\n");
+
+    /* Live blocks per size class, bars scaled to the busiest class */
+    struct mem_class_stats stats;
+    size_t max_blocks = 0;
+    for (int i = 0; i < MEM_NUM_CLASSES; i++) {
+        memory_get_class_stats(i, &stats);
+        if (stats.used_blocks > max_blocks) {
+            max_blocks = stats.used_blocks;
+        }
+    }
+
+    vga_set_color(VGA_COLOR_LIGHT_CYAN, VGA_COLOR_BLACK);
+    vga_print("  Up to size   Live blocks\n");
+    vga_set_color(VGA_COLOR_WHITE, VGA_COLOR_BLACK);
+    for (int i = 0; i < MEM_NUM_CLASSES; i++) {
+        memory_get_class_stats(i, &stats);
+        if (stats.used_blocks == 0) {
+            continue;
+        }
+
+        vga_print("  ");
+        if (stats.max_size == 0) {
+            vga_print("     large");
+        } else {
+            print_padded_dec(stats.max_size, 10);
+        }
+        vga_print("  ");
+        int bar = (int)((stats.used_blocks * 40 + max_blocks - 1) / max_blocks);
+        for (int j = 0; j < bar; j++) {
+            vga_putchar('#');
+        }
+        vga_putchar(' ');
+        vga_print_dec(stats.used_blocks);
+        vga_print("\n");
+    }
+
+    /* Memory reclaim callbacks, in the order they are asked */
+    struct mem_shrinker_stats shrink;
+
+    vga_print("\n");
+    vga_set_color(VGA_COLOR_LIGHT_CYAN, VGA_COLOR_BLACK);
+    vga_print("  Shrinker      Prio     Calls  Reclaimed KB\n");
+    vga_set_color(VGA_COLOR_WHITE, VGA_COLOR_BLACK);
+    for (int i = 0; memory_get_shrinker_stats(i, &shrink) == 0; i++) {
+        vga_print("  ");
+        vga_print(shrink.name);
+        for (int j = strlen(shrink.name); j < 10; j++) {
+            vga_putchar(' ');
+        }
+        print_padded_dec(shrink.priority, 8);
+        print_padded_dec(shrink.calls, 10);
+        print_padded_dec(shrink.reclaimed / 1024, 14);
+        vga_print("\n");
+    }
+
+    /* Biggest live call sites */
+    struct mem_site_stats sites[8];
+    int count = memory_get_top_sites(sites, 8);
+
+    vga_print("\n");
+    if (count < 0) {
+        vga_print("  Call sites: not recorded (build with HEAP_TAGS=1)\n\n");
+        return;
+    }
+
+    vga_set_color(VGA_COLOR_LIGHT_CYAN, VGA_COLOR_BLACK);
+    vga_print("  Caller      Blocks       Bytes\n");
+    vga_set_color(VGA_COLOR_WHITE, VGA_COLOR_BLACK);
+    for (int i = 0; i < count; i++) {
+        vga_print("  ");
+        if (sites[i].caller == 0) {
+            vga_print("(other) ");
+        } else {
+            vga_print_hex(sites[i].caller);
+        }
+        print_padded_dec(sites[i].blocks, 10);
+        print_padded_dec(sites[i].bytes, 12);
+        vga_print("\n");
+    }
+    vga_print("\n");
+}
+
+/*
+ * Command: memmap
+ */
+static void cmd_memmap(int argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+
+    static const char *type_names[] = {
+        "Unknown", "Usable", "Reserved", "ACPI reclaimable", "ACPI NVS", "Bad memory"
+    };
+
+    const struct e820_entry *map;
+    size_t count = pmm_get_memory_map(&map);
+
+    vga_set_color(VGA_COLOR_LIGHT_CYAN, VGA_COLOR_BLACK);
+    vga_print("\n=== BIOS Memory Map ===\n\n");
+    vga_set_color(VGA_COLOR_WHITE, VGA_COLOR_BLACK);
+
+    for (size_t i = 0; i < count; i++) {
+        uint64_t end = map[i].base + map[i].length - 1;
+
+        vga_print("  ");
+        print_hex64(map[i].base);
+        vga_print(" - ");
+        print_hex64(end);
+        vga_print("  ");
+        vga_print(type_names[map[i].type <= E820_BAD ? map[i].type : 0]);
+        vga_print("\n");
+    }
+    vga_print("\n");
 }
 
 /*
@@ -531,17 +914,91 @@ static void cmd_cat(int argc, char *argv[])
         return;
     }
 
-    /* Read and display file contents */
-    char *buffer = kmalloc(size + 1);
-    if (buffer) {
-        fs_read(file, buffer, size, 0);
-        buffer[size] = '\0';
-        vga_print(buffer);
-        if (buffer[size - 1] != '\n') {
-            vga_print("\n");
+    /* Display the file's own bytes, no copy */
+    struct kslice contents;
+    fs_get_data(file, &contents);
+    vga_write((const char *)contents.data, contents.len);
+    if (contents.data[contents.len - 1] != '\n') {
+        vga_print("\n");
+    }
+    kslice_release(&contents);
+}
+
+/* sum: hash at least this much data per timing */
+#define SUM_MIN_BYTES   (1024 * 1024)
+
+enum { SUM_CRC32C_SW, SUM_CRC32C_HW, SUM_XXHASH32 };
+
+/*
+ * Hash data reps times with one algorithm; returns the TSC cycles taken
+ */
+static uint32_t sum_time(int algo, const void *data, size_t len, uint32_t reps, uint32_t *result)
+{
+    uint64_t start = rdtsc();
+    for (uint32_t r = 0; r < reps; r++) {
+        if (algo == SUM_CRC32C_SW) {
+            *result = crc32c_sw(0, data, len);
+        } else if (algo == SUM_CRC32C_HW) {
+            *result = crc32c_hw(0, data, len);
+        } else {
+            *result = xxhash32(data, len, 0);
         }
-        kfree(buffer);
     }
+    return (uint32_t)(rdtsc() - start);
+}
+
+/*
+ * Command: sum - Checksum a file and report the hashing rate
+ */
+static void cmd_sum(int argc, char *argv[])
+{
+    if (argc < 2) {
+        vga_print("Usage: sum <filename>\n");
+        return;
+    }
+
+    fs_file_t *file = fs_open(argv[1]);
+    if (!file) {
+        vga_set_color(VGA_COLOR_LIGHT_RED, VGA_COLOR_BLACK);
+        vga_print("Error: File '");
+        vga_print(argv[1]);
+        vga_print("' not found\n");
+        vga_set_color(VGA_COLOR_WHITE, VGA_COLOR_BLACK);
+        return;
+    }
+
+    static const char *names[] = { "crc32c (slice-by-8)", "crc32c (sse4.2)", "xxhash32" };
+
+    struct kslice contents;
+    fs_get_data(file, &contents);
+
+    /* Repeat small files so the timing covers enough data to measure */
+    uint32_t reps = 1;
+    if (contents.len > 0 && contents.len < SUM_MIN_BYTES) {
+        reps = (SUM_MIN_BYTES + contents.len - 1) / contents.len;
+    }
+    uint32_t kbytes = (uint32_t)(((uint64_t)contents.len * reps) >> 10);
+    uint32_t tsc_khz = timer_get_tsc_khz();
+
+    kprintf("%s: %zu bytes\n", argv[1], contents.len);
+
+    for (int algo = SUM_CRC32C_SW; algo <= SUM_XXHASH32; algo++) {
+        if (algo == SUM_CRC32C_HW && !cpu_has(CPU_FEATURE_SSE42)) {
+            continue;
+        }
+
+        uint32_t result = 0;
+        uint32_t cycles = sum_time(algo, contents.data, contents.len, reps, &result);
+        kprintf("  %-20s %08x", names[algo], result);
+
+        uint32_t mbps = bench_mbps(kbytes, cycles, tsc_khz);
+        if (tsc_khz != 0 && kbytes != 0 && cycles != 0 && mbps != 0xFFFFFFFF) {
+            kprintf("  %6u MB/s", mbps);
+        }
+        kprintf("\n");
+    }
+
+    kslice_release(&contents);
 }
 
 /*
@@ -599,11 +1056,62 @@ static void cmd_rm(int argc, char *argv[])
 }
 
 /*
- * Command: nano - Simple text editor
+ * nano: read a line of input on the status bar. Returns false if the
+ * prompt was cancelled with Esc.
  */
-#define NANO_MAX_LINES  100
-#define NANO_LINE_LEN   80
+static bool nano_prompt(const char *label, char *buf, size_t size)
+{
+    size_t len = 0;
+    buf[0] = '\0';
+
+    for (;;) {
+        vga_set_cursor(23, 0);
+        vga_set_color(VGA_COLOR_BLACK, VGA_COLOR_LIGHT_GREY);
+        kprintf("  %s%-*s", label, (int)(77 - strlen(label)), buf);
+        vga_set_color(VGA_COLOR_WHITE, VGA_COLOR_BLACK);
+        vga_set_cursor(23, 2 + strlen(label) + len);
+
+        char c = keyboard_getchar();
+        if (c == 27) {
+            return false;
+        } else if (c == '\n' || c == '\r') {
+            return true;
+        } else if (c == '\b') {
+            if (len > 0) buf[--len] = '\0';
+        } else if (c >= 32 && c < 127 && len < size - 1) {
+            buf[len++] = c;
+            buf[len] = '\0';
+        }
+    }
+}
+
+/*
+ * nano: find the next occurrence of term after (*line, *col), wrapping
+ * around to the top. Moves the position there and returns true if found.
+ */
+static bool nano_find(char **lines, int num_lines, const char *term, int *line, int *col)
+{
+    for (int i = 0; i <= num_lines; i++) {
+        int l = (*line + i) % num_lines;
+        int start = (i == 0) ? *col + 1 : 0;
+        if (start > (int)strlen(lines[l])) {
+            continue;
+        }
+
+        /* Back on the starting line (i == num_lines), only up to the cursor */
+        char *match = strstr(lines[l] + start, term);
+        if (match != NULL && (i < num_lines || match - lines[l] <= *col)) {
+            *line = l;
+            *col = match - lines[l];
+            return true;
+        }
+    }
+    return false;
+}
 
+/*
+ * Command: nano - Simple text editor
+ */
 static void cmd_nano(int argc, char *argv[])
 {
     if (argc < 2) {
@@ -612,6 +1120,11 @@ static void cmd_nano(int argc, char *argv[])
     }
 
     const char *filename = argv[1];
+
+    if (nano_line_cache == NULL) {
+        vga_print("Error: Out of memory\n");
+        return;
+    }
     
     /* Create file if it doesn't exist */
     if (!fs_exists(filename)) {
@@ -619,14 +1132,14 @@ static void cmd_nano(int argc, char *argv[])
     }
 
     /* Allocate text buffer */
-    char **lines = kmalloc(NANO_MAX_LINES * sizeof(char *));
+    char **lines = arena_alloc(command_arena, NANO_MAX_LINES * sizeof(char *));
     if (!lines) {
         vga_print("Error: Out of memory\n");
         return;
     }
     
     for (int i = 0; i < NANO_MAX_LINES; i++) {
-        lines[i] = kmalloc(NANO_LINE_LEN);
+        lines[i] = kmem_cache_alloc(nano_line_cache);
         if (lines[i]) {
             lines[i][0] = '\0';
         }
@@ -635,36 +1148,38 @@ static void cmd_nano(int argc, char *argv[])
     int num_lines = 1;
     int cur_line = 0;
     int cur_col = 0;
+    int top_line = 0;       /* First line shown */
     int modified = 0;
+    const char *message = NULL;
+    char search[NANO_LINE_LEN];     /* Last term, for an empty Ctrl+W */
+    search[0] = '\0';
 
     /* Load existing file content */
     fs_file_t *file = fs_open(filename);
     if (file && fs_get_size(file) > 0) {
-        size_t size = fs_get_size(file);
-        char *content = kmalloc(size + 1);
-        if (content) {
-            fs_read(file, content, size, 0);
-            content[size] = '\0';
-            
-            /* Parse into lines */
-            num_lines = 0;
-            char *p = content;
-            while (*p && num_lines < NANO_MAX_LINES) {
-                char *line_start = p;
-                while (*p && *p != '\n') p++;
-                
-                size_t len = p - line_start;
-                if (len >= NANO_LINE_LEN) len = NANO_LINE_LEN - 1;
-                
-                strncpy(lines[num_lines], line_start, len);
-                lines[num_lines][len] = '\0';
-                num_lines++;
-                
-                if (*p == '\n') p++;
-            }
-            if (num_lines == 0) num_lines = 1;
-            kfree(content);
+        struct kslice contents;
+        fs_get_data(file, &contents);
+
+        /* Parse into lines */
+        num_lines = 0;
+        const char *p = (const char *)contents.data;
+        const char *end = p + contents.len;
+        while (p < end && *p && num_lines < NANO_MAX_LINES) {
+            const char *line_start = p;
+            while (p < end && *p && *p != '\n') p++;
+
+            size_t len = p - line_start;
+            if (len >= NANO_LINE_LEN) len = NANO_LINE_LEN - 1;
+
+            strncpy(lines[num_lines], line_start, len);
+            lines[num_lines][len] = '\0';
+            num_lines++;
+
+            if (p < end && *p == '\n') p++;
         }
+        if (num_lines == 0) num_lines = 1;
+
+        kslice_release(&contents);
     }
 
     /* Editor main loop */
@@ -676,24 +1191,28 @@ static void cmd_nano(int argc, char *argv[])
         
         /* Title bar */
         vga_set_color(VGA_COLOR_BLACK, VGA_COLOR_WHITE);
-        vga_print("  KontolOS nano - ");
-        vga_print(filename);
-        if (modified) vga_print(" [modified]");
-        for (int i = 40 + strlen(filename); i < 80; i++) vga_putchar(' ');
+        kprintf("  KontolOS nano - %s%s%*s", filename, modified ? " [modified]" : "",
+                (int)(40 - strlen(filename)), "");
         
-        /* Content area (lines 1-22) */
+        /* Content area (lines 1-22), scrolled to top_line */
         vga_set_color(VGA_COLOR_WHITE, VGA_COLOR_BLACK);
-        for (int i = 0; i < 22 && i < num_lines; i++) {
+        for (int i = 0; i < NANO_VIEW_ROWS && top_line + i < num_lines; i++) {
             vga_set_cursor(i + 1, 0);
-            if (lines[i]) {
-                vga_print(lines[i]);
+            if (lines[top_line + i]) {
+                vga_print(lines[top_line + i]);
             }
         }
         
         /* Status bar (line 23) */
         vga_set_cursor(23, 0);
         vga_set_color(VGA_COLOR_BLACK, VGA_COLOR_LIGHT_GREY);
-        vga_print("  ^S Save  ^X Exit                                Line:");
+        if (message) {
+            kprintf("  %-48s", message);
+            message = NULL;
+        } else {
+            vga_print("  ^S Save  ^W Find  ^X Exit                       ");
+        }
+        vga_print("Line:");
         vga_print_dec(cur_line + 1);
         vga_print(" Col:");
         vga_print_dec(cur_col + 1);
@@ -701,14 +1220,24 @@ static void cmd_nano(int argc, char *argv[])
         
         /* Position cursor */
         vga_set_color(VGA_COLOR_WHITE, VGA_COLOR_BLACK);
-        vga_set_cursor(cur_line + 1, cur_col);
+        vga_set_cursor(cur_line - top_line + 1, cur_col);
         vga_show_cursor();
         
         /* Get input */
         char c = keyboard_getchar();
         
         /* Handle control keys */
-        if (c == 19) {  /* Ctrl+S = Save */
+        if (c == 23) {  /* Ctrl+W = Find (empty input repeats the last search) */
+            char term[NANO_LINE_LEN];
+            if (nano_prompt("Search: ", term, sizeof(term))) {
+                if (term[0]) {
+                    strcpy(search, term);
+                }
+                if (search[0] && !nano_find(lines, num_lines, search, &cur_line, &cur_col)) {
+                    message = "Not found";
+                }
+            }
+        } else if (c == 19) {  /* Ctrl+S = Save */
             /* Build content string */
             size_t total_size = 0;
             for (int i = 0; i < num_lines; i++) {
@@ -790,13 +1319,16 @@ static void cmd_nano(int argc, char *argv[])
         if (cur_col > (int)strlen(lines[cur_line])) {
             cur_col = strlen(lines[cur_line]);
         }
+
+        /* Scroll so the cursor line stays in view */
+        if (cur_line < top_line) top_line = cur_line;
+        if (cur_line >= top_line + NANO_VIEW_ROWS) top_line = cur_line - NANO_VIEW_ROWS + 1;
     }
 
     /* Cleanup */
     for (int i = 0; i < NANO_MAX_LINES; i++) {
-        if (lines[i]) kfree(lines[i]);
+        if (lines[i]) kmem_cache_free(nano_line_cache, lines[i]);
     }
-    kfree(lines);
 
     /* Restore screen */
     vga_clear();
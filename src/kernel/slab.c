@@ -0,0 +1,365 @@
+/*
+ * KontolOS Slab Allocator
+ *
+ * Fixed-size object caches on top of the kmalloc heap. Each slab is one
+ * page-aligned page: a small header followed by equally sized object
+ * slots. Free objects are chained through their first word, so objects
+ * carry no per-allocation header, and the owning slab of any object is
+ * found by masking its address down to the page boundary. Caches with a
+ * constructor keep the link in an extra word after the object instead,
+ * so the constructed state survives while the object sits free.
+ */
+
+#include "slab.h"
+#include "memory.h"
+
+/* Slab header, at the start of every slab page */
+struct slab {
+    struct slab *prev;
+    struct slab *next;
+    struct kmem_cache *cache;
+    void *free_list;        /* Free objects in this slab */
+    uint16_t in_use;
+    uint16_t total;
+};
+
+/* Cache descriptor */
+struct kmem_cache {
+    const char *name;
+    size_t object_size;
+    size_t slot_size;
+    size_t first_offset;    /* Offset of the first object in a slab */
+    size_t link_offset;     /* Offset of the next-free link in a slot */
+    uint16_t objects_per_slab;
+    kmem_ctor_t ctor;
+
+    /* Slab lists */
+    struct slab *partial;   /* Some objects free (allocate from here) */
+    struct slab *full;      /* No objects free */
+    struct slab *empty;     /* All objects free (kept for reuse) */
+
+    /* Statistics */
+    size_t slabs;
+    size_t active_objects;
+    uint32_t allocs;
+    uint32_t frees;
+
+    struct kmem_cache *next_cache;
+};
+
+/* All caches, for statistics */
+static struct kmem_cache *cache_list = NULL;
+
+/* Next-free link of a free object */
+static inline void **obj_link(struct kmem_cache *cache, void *obj)
+{
+    return (void **)((uint8_t *)obj + cache->link_offset);
+}
+
+/*
+ * Slab list helpers
+ */
+static void slab_list_add(struct slab **list, struct slab *slab)
+{
+    slab->prev = NULL;
+    slab->next = *list;
+    if (*list != NULL) {
+        (*list)->prev = slab;
+    }
+    *list = slab;
+}
+
+static void slab_list_remove(struct slab **list, struct slab *slab)
+{
+    if (slab->prev != NULL) {
+        slab->prev->next = slab->next;
+    } else {
+        *list = slab->next;
+    }
+    if (slab->next != NULL) {
+        slab->next->prev = slab->prev;
+    }
+}
+
+/*
+ * Get the slab an object belongs to
+ */
+static inline struct slab *obj_to_slab(void *obj)
+{
+    return (struct slab *)((uintptr_t)obj & ~(uintptr_t)(SLAB_SIZE - 1));
+}
+
+/*
+ * Allocate and carve a new slab for a cache
+ */
+static struct slab *slab_create(struct kmem_cache *cache)
+{
+    struct slab *slab = kmalloc_page();
+    if (slab == NULL) {
+        return NULL;
+    }
+
+    slab->cache = cache;
+    slab->in_use = 0;
+    slab->total = cache->objects_per_slab;
+    slab->free_list = NULL;
+
+    /* Chain the slots in address order for locality */
+    uint8_t *base = (uint8_t *)slab + cache->first_offset;
+    for (int i = cache->objects_per_slab - 1; i >= 0; i--) {
+        void *obj = base + (size_t)i * cache->slot_size;
+        if (cache->ctor != NULL) {
+            cache->ctor(obj);
+        }
+        *obj_link(cache, obj) = slab->free_list;
+        slab->free_list = obj;
+    }
+
+    cache->slabs++;
+    return slab;
+}
+
+/*
+ * Release a slab page back to the heap
+ */
+static void slab_destroy(struct kmem_cache *cache, struct slab *slab)
+{
+    cache->slabs--;
+    kfree(slab);
+}
+
+/*
+ * Create an object cache
+ *
+ * align of 0 means the default 8-byte alignment. Objects must be small
+ * enough that a slab holds at least one of them.
+ */
+struct kmem_cache *kmem_cache_create(const char *name, size_t size, size_t align,
+                                     uint32_t flags, kmem_ctor_t ctor)
+{
+    if (size == 0) {
+        return NULL;
+    }
+
+    if (align < 8) {
+        align = 8;
+    }
+    if ((flags & KMEM_CACHE_HWALIGN) && align < CACHE_LINE_SIZE) {
+        align = CACHE_LINE_SIZE;
+    }
+    if (align & (align - 1)) {
+        return NULL;    /* Alignment must be a power of two */
+    }
+
+    /*
+     * Free slots hold the next-free pointer: in the first word normally,
+     * or in a word of its own after the object when a constructor has
+     * set the object up and it must not be overwritten.
+     */
+    size_t link = 0;
+    size_t slot = (size < sizeof(void *)) ? sizeof(void *) : size;
+    if (ctor != NULL) {
+        link = (size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+        slot = link + sizeof(void *);
+    }
+    slot = (slot + align - 1) & ~(align - 1);
+
+    size_t first = (sizeof(struct slab) + align - 1) & ~(align - 1);
+    if (first + slot > SLAB_SIZE) {
+        return NULL;
+    }
+
+    struct kmem_cache *cache = kmalloc(sizeof(struct kmem_cache));
+    if (cache == NULL) {
+        return NULL;
+    }
+
+    cache->name = name;
+    cache->object_size = size;
+    cache->slot_size = slot;
+    cache->first_offset = first;
+    cache->link_offset = link;
+    cache->objects_per_slab = (uint16_t)((SLAB_SIZE - first) / slot);
+    cache->ctor = ctor;
+    cache->partial = NULL;
+    cache->full = NULL;
+    cache->empty = NULL;
+    cache->slabs = 0;
+    cache->active_objects = 0;
+    cache->allocs = 0;
+    cache->frees = 0;
+
+    cache->next_cache = cache_list;
+    cache_list = cache;
+
+    return cache;
+}
+
+/*
+ * Destroy a cache and release all of its slabs
+ * (outstanding objects become invalid)
+ */
+void kmem_cache_destroy(struct kmem_cache *cache)
+{
+    if (cache == NULL) {
+        return;
+    }
+
+    struct slab **lists[3] = { &cache->partial, &cache->full, &cache->empty };
+    for (int i = 0; i < 3; i++) {
+        while (*lists[i] != NULL) {
+            struct slab *slab = *lists[i];
+            slab_list_remove(lists[i], slab);
+            slab_destroy(cache, slab);
+        }
+    }
+
+    /* Unlink from the cache list */
+    struct kmem_cache **link = &cache_list;
+    while (*link != NULL && *link != cache) {
+        link = &(*link)->next_cache;
+    }
+    if (*link != NULL) {
+        *link = cache->next_cache;
+    }
+
+    kfree(cache);
+}
+
+/*
+ * Allocate an object from a cache
+ */
+void *kmem_cache_alloc(struct kmem_cache *cache)
+{
+    struct slab *slab = cache->partial;
+
+    if (slab == NULL) {
+        /* Reuse an empty slab before asking the heap for a new one */
+        slab = cache->empty;
+        if (slab != NULL) {
+            slab_list_remove(&cache->empty, slab);
+        } else {
+            slab = slab_create(cache);
+            if (slab == NULL) {
+                return NULL;
+            }
+        }
+        slab_list_add(&cache->partial, slab);
+    }
+
+    void *obj = slab->free_list;
+    slab->free_list = *obj_link(cache, obj);
+    slab->in_use++;
+
+    if (slab->in_use == slab->total) {
+        slab_list_remove(&cache->partial, slab);
+        slab_list_add(&cache->full, slab);
+    }
+
+    cache->active_objects++;
+    cache->allocs++;
+    return obj;
+}
+
+/*
+ * Return an object to its cache
+ */
+void kmem_cache_free(struct kmem_cache *cache, void *obj)
+{
+    if (obj == NULL) {
+        return;
+    }
+
+    struct slab *slab = obj_to_slab(obj);
+    if (slab->cache != cache) {
+        return;     /* Not from this cache */
+    }
+
+    bool was_full = (slab->in_use == slab->total);
+
+    *obj_link(cache, obj) = slab->free_list;
+    slab->free_list = obj;
+    slab->in_use--;
+
+    if (was_full) {
+        slab_list_remove(&cache->full, slab);
+        slab_list_add(&cache->partial, slab);
+    }
+
+    if (slab->in_use == 0) {
+        slab_list_remove(&cache->partial, slab);
+        if (cache->empty == NULL) {
+            /* Keep one empty slab around to absorb alloc/free churn */
+            slab_list_add(&cache->empty, slab);
+        } else {
+            slab_destroy(cache, slab);
+        }
+    }
+
+    cache->active_objects--;
+    cache->frees++;
+}
+
+/*
+ * Release a cache's empty slabs, returns the bytes given back
+ */
+size_t kmem_cache_shrink(struct kmem_cache *cache)
+{
+    size_t freed = 0;
+
+    while (cache->empty != NULL) {
+        struct slab *slab = cache->empty;
+        slab_list_remove(&cache->empty, slab);
+        slab_destroy(cache, slab);
+        freed += SLAB_SIZE;
+    }
+    return freed;
+}
+
+/*
+ * Shrinker: drop the empty slabs every cache keeps for reuse
+ */
+static size_t slab_shrink(size_t wanted)
+{
+    size_t freed = 0;
+
+    for (struct kmem_cache *cache = cache_list; cache != NULL && freed < wanted;
+         cache = cache->next_cache) {
+        freed += kmem_cache_shrink(cache);
+    }
+    return freed;
+}
+
+/*
+ * Hook the slab layer into memory reclaim (after memory_init)
+ */
+void slab_init(void)
+{
+    memory_register_shrinker("slab", SHRINK_PRIO_CACHE, slab_shrink);
+}
+
+/*
+ * Get statistics for the cache at position index
+ */
+int kmem_cache_get_stats(int index, struct kmem_cache_stats *stats)
+{
+    struct kmem_cache *cache = cache_list;
+    while (cache != NULL && index-- > 0) {
+        cache = cache->next_cache;
+    }
+
+    if (cache == NULL || stats == NULL) {
+        return -1;
+    }
+
+    stats->name = cache->name;
+    stats->object_size = cache->object_size;
+    stats->slot_size = cache->slot_size;
+    stats->objects_per_slab = cache->objects_per_slab;
+    stats->slabs = cache->slabs;
+    stats->active_objects = cache->active_objects;
+    stats->total_objects = cache->slabs * cache->objects_per_slab;
+    stats->allocs = cache->allocs;
+    stats->frees = cache->frees;
+    return 0;
+}
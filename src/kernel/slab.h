@@ -0,0 +1,53 @@
+/*
+ * KontolOS Slab Allocator Header
+ */
+
+#ifndef SLAB_H
+#define SLAB_H
+
+#include "../include/types.h"
+
+/* Slab geometry */
+#define SLAB_SIZE           4096    /* One page per slab */
+#define CACHE_LINE_SIZE     64
+
+/* Cache flags */
+#define KMEM_CACHE_HWALIGN  0x01    /* Align objects to cache lines */
+
+/* Object constructor, run once per object when its slab is created; the
+ * state it sets up is kept across kmem_cache_free and reallocation */
+typedef void (*kmem_ctor_t)(void *obj);
+
+/* Opaque cache handle */
+struct kmem_cache;
+
+/* Per-cache statistics */
+struct kmem_cache_stats {
+    const char *name;
+    size_t object_size;     /* Requested object size */
+    size_t slot_size;       /* Object size after alignment */
+    size_t objects_per_slab;
+    size_t slabs;
+    size_t active_objects;
+    size_t total_objects;
+    uint32_t allocs;
+    uint32_t frees;
+};
+
+/* Register the slab shrinker (after memory_init) */
+void slab_init(void);
+
+/* Cache management */
+struct kmem_cache *kmem_cache_create(const char *name, size_t size, size_t align,
+                                     uint32_t flags, kmem_ctor_t ctor);
+void kmem_cache_destroy(struct kmem_cache *cache);
+size_t kmem_cache_shrink(struct kmem_cache *cache);
+
+/* Object allocation */
+void *kmem_cache_alloc(struct kmem_cache *cache);
+void kmem_cache_free(struct kmem_cache *cache, void *obj);
+
+/* Statistics (index-based walk over all caches; -1 past the end) */
+int kmem_cache_get_stats(int index, struct kmem_cache_stats *stats);
+
+#endif /* SLAB_H */
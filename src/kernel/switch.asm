@@ -0,0 +1,34 @@
+; ============================================================================
+; KontolOS Context Switch
+; ============================================================================
+
+[BITS 32]
+
+global context_switch
+
+section .text
+
+; ============================================================================
+; void context_switch(uint32_t *save_esp, uint32_t load_esp)
+;
+; Push the callee-saved registers, store the stack pointer in *save_esp,
+; then load load_esp and pop the registers saved there. The ret returns
+; into whoever last switched away from that stack (or to the entry point
+; placed on top of a new one).
+; ============================================================================
+context_switch:
+    mov eax, [esp + 4]
+    mov edx, [esp + 8]
+
+    push ebp
+    push ebx
+    push esi
+    push edi
+    mov [eax], esp
+
+    mov esp, edx
+    pop edi
+    pop esi
+    pop ebx
+    pop ebp
+    ret
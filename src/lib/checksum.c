@@ -0,0 +1,209 @@
+/*
+ * KontolOS Checksum Functions
+ *
+ * CRC32C in software uses slice-by-8: eight 256-entry tables, where
+ * table k gives the CRC contribution of a byte followed by k zero
+ * bytes, so eight input bytes are folded in with eight independent
+ * lookups instead of a chain of eight dependent ones. CPUs with SSE4.2
+ * have a crc32 instruction for the same polynomial, four bytes per
+ * instruction. It works on general registers, so unlike the SSE memcpy
+ * it needs no FPU state.
+ *
+ * xxHash32 keeps four independent accumulators over 16-byte stripes.
+ */
+
+#include "checksum.h"
+#include "../kernel/cpu.h"
+
+/* Reflected Castagnoli polynomial */
+#define CRC32C_POLY     0x82F63B78u
+
+#define XXH_PRIME1      0x9E3779B1u
+#define XXH_PRIME2      0x85EBCA77u
+#define XXH_PRIME3      0xC2B2AE3Du
+#define XXH_PRIME4      0x27D4EB2Fu
+#define XXH_PRIME5      0x165667B1u
+
+typedef uint32_t __attribute__((may_alias)) word_t;
+typedef uint32_t __attribute__((may_alias, aligned(1))) uword_t;
+
+/* Built by checksum_init (8KB of BSS rather than 8KB of image) */
+static uint32_t crc_table[8][256];
+static bool crc_use_hw = false;
+
+/*
+ * Build the tables and select the implementation
+ */
+void checksum_init(void)
+{
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ ((crc & 1) ? CRC32C_POLY : 0);
+        }
+        crc_table[0][i] = crc;
+    }
+    for (uint32_t i = 0; i < 256; i++) {
+        for (int k = 1; k < 8; k++) {
+            uint32_t prev = crc_table[k - 1][i];
+            crc_table[k][i] = (prev >> 8) ^ crc_table[0][prev & 0xFF];
+        }
+    }
+
+    crc_use_hw = cpu_has(CPU_FEATURE_SSE42);
+}
+
+/*
+ * CRC32C, slice-by-8
+ */
+uint32_t crc32c_sw(uint32_t crc, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+    crc = ~crc;
+
+    /* Bytes up to a word boundary */
+    while (len > 0 && ((uintptr_t)p & 3)) {
+        crc = (crc >> 8) ^ crc_table[0][(crc ^ *p++) & 0xFF];
+        len--;
+    }
+
+    while (len >= 8) {
+        uint32_t one = *(const word_t *)p ^ crc;
+        uint32_t two = *(const word_t *)(p + 4);
+        crc = crc_table[7][one & 0xFF] ^
+              crc_table[6][(one >> 8) & 0xFF] ^
+              crc_table[5][(one >> 16) & 0xFF] ^
+              crc_table[4][one >> 24] ^
+              crc_table[3][two & 0xFF] ^
+              crc_table[2][(two >> 8) & 0xFF] ^
+              crc_table[1][(two >> 16) & 0xFF] ^
+              crc_table[0][two >> 24];
+        p += 8;
+        len -= 8;
+    }
+
+    while (len-- > 0) {
+        crc = (crc >> 8) ^ crc_table[0][(crc ^ *p++) & 0xFF];
+    }
+
+    return ~crc;
+}
+
+/*
+ * CRC32C with the SSE4.2 crc32 instruction
+ */
+uint32_t crc32c_hw(uint32_t crc, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+    crc = ~crc;
+
+    while (len > 0 && ((uintptr_t)p & 3)) {
+        __asm__("crc32b %1, %0" : "+r"(crc) : "qm"(*p));
+        p++;
+        len--;
+    }
+
+    while (len >= 16) {
+        const word_t *w = (const word_t *)p;
+        __asm__("crc32l %1, %0\n\t"
+                "crc32l %2, %0\n\t"
+                "crc32l %3, %0\n\t"
+                "crc32l %4, %0"
+                : "+r"(crc)
+                : "rm"(w[0]), "rm"(w[1]), "rm"(w[2]), "rm"(w[3]));
+        p += 16;
+        len -= 16;
+    }
+
+    while (len >= 4) {
+        __asm__("crc32l %1, %0" : "+r"(crc) : "rm"(*(const word_t *)p));
+        p += 4;
+        len -= 4;
+    }
+
+    while (len-- > 0) {
+        __asm__("crc32b %1, %0" : "+r"(crc) : "qm"(*p));
+        p++;
+    }
+
+    return ~crc;
+}
+
+/*
+ * CRC32C with the best available implementation
+ */
+uint32_t crc32c(uint32_t crc, const void *data, size_t len)
+{
+    if (crc_use_hw) {
+        return crc32c_hw(crc, data, len);
+    }
+    return crc32c_sw(crc, data, len);
+}
+
+const char *crc32c_impl_name(void)
+{
+    return crc_use_hw ? "sse4.2" : "slice-by-8";
+}
+
+/*
+ * xxHash32
+ */
+static inline uint32_t rotl32(uint32_t x, int r)
+{
+    return (x << r) | (x >> (32 - r));
+}
+
+static inline uint32_t xxh_round(uint32_t acc, uint32_t input)
+{
+    acc += input * XXH_PRIME2;
+    acc = rotl32(acc, 13);
+    return acc * XXH_PRIME1;
+}
+
+uint32_t xxhash32(const void *data, size_t len, uint32_t seed)
+{
+    const uint8_t *p = data;
+    const uint8_t *end = p + len;
+    uint32_t h;
+
+    if (len >= 16) {
+        uint32_t v1 = seed + XXH_PRIME1 + XXH_PRIME2;
+        uint32_t v2 = seed + XXH_PRIME2;
+        uint32_t v3 = seed;
+        uint32_t v4 = seed - XXH_PRIME1;
+        const uint8_t *limit = end - 16;
+
+        do {
+            v1 = xxh_round(v1, *(const uword_t *)p);
+            v2 = xxh_round(v2, *(const uword_t *)(p + 4));
+            v3 = xxh_round(v3, *(const uword_t *)(p + 8));
+            v4 = xxh_round(v4, *(const uword_t *)(p + 12));
+            p += 16;
+        } while (p <= limit);
+
+        h = rotl32(v1, 1) + rotl32(v2, 7) + rotl32(v3, 12) + rotl32(v4, 18);
+    } else {
+        h = seed + XXH_PRIME5;
+    }
+
+    h += (uint32_t)len;
+
+    while (p + 4 <= end) {
+        h += *(const uword_t *)p * XXH_PRIME3;
+        h = rotl32(h, 17) * XXH_PRIME4;
+        p += 4;
+    }
+
+    while (p < end) {
+        h += *p++ * XXH_PRIME5;
+        h = rotl32(h, 11) * XXH_PRIME1;
+    }
+
+    /* Final avalanche */
+    h ^= h >> 15;
+    h *= XXH_PRIME2;
+    h ^= h >> 13;
+    h *= XXH_PRIME3;
+    h ^= h >> 16;
+    return h;
+}
@@ -0,0 +1,29 @@
+/*
+ * KontolOS Checksum Functions Header
+ */
+
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include "../include/types.h"
+
+/* Build the CRC tables and pick the CRC32C path (needs cpu_init first) */
+void checksum_init(void);
+
+/*
+ * CRC32C (Castagnoli). Pass 0 to start, or a previous result to
+ * continue over more data; crc32c(0, "123456789", 9) == 0xE3069283.
+ */
+uint32_t crc32c(uint32_t crc, const void *data, size_t len);
+
+/* The individual paths, for testing and benchmarks */
+uint32_t crc32c_sw(uint32_t crc, const void *data, size_t len);
+uint32_t crc32c_hw(uint32_t crc, const void *data, size_t len);    /* SSE4.2 only */
+
+/* Name of the path crc32c() uses ("slice-by-8" or "sse4.2") */
+const char *crc32c_impl_name(void);
+
+/* xxHash32, a fast non-cryptographic hash (not incremental) */
+uint32_t xxhash32(const void *data, size_t len, uint32_t seed);
+
+#endif /* CHECKSUM_H */
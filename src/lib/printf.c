@@ -0,0 +1,481 @@
+/*
+ * KontolOS Formatted Output
+ *
+ * One formatter serves every entry point. Output collects in a buffer;
+ * for sinks the buffer lives on the stack and is flushed when it fills
+ * up and at the end of the call, so a typical kprintf reaches the
+ * console in a single write. Decimal conversion produces two digits
+ * per division from a table of digit pairs, and 64-bit values are
+ * split into 9-digit chunks with 32-bit divides (no libgcc).
+ */
+
+#include "printf.h"
+#include "string.h"
+#include "../drivers/vga.h"
+#include "../drivers/serial.h"
+#include "../kernel/kernel.h"
+
+/* Formatter state */
+struct printf_out {
+    char *buf;
+    size_t size;            /* Buffer capacity */
+    size_t len;             /* Bytes in the buffer */
+    size_t total;           /* Bytes produced so far */
+    printf_sink_t sink;     /* NULL = fixed buffer, excess is dropped */
+    void *ctx;
+};
+
+/* Conversion flags */
+#define FLAG_LEFT       0x01
+#define FLAG_ZERO       0x02
+#define FLAG_PLUS       0x04
+#define FLAG_SPACE      0x08
+#define FLAG_ALT        0x10
+
+/* Argument lengths (l, z and t are the same size as int on i386) */
+#define LENGTH_INT      0
+#define LENGTH_CHAR     1   /* hh */
+#define LENGTH_SHORT    2   /* h */
+#define LENGTH_64       3   /* ll, j */
+
+/* Longest conversion: 64-bit octal is 22 digits */
+#define NUM_BUFFER_SIZE 24
+
+static const char digit_pairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+static const char hex_lower[] = "0123456789abcdef";
+static const char hex_upper[] = "0123456789ABCDEF";
+
+/*
+ * Output helpers
+ */
+static void out_flush(struct printf_out *out)
+{
+    if (out->sink != NULL && out->len > 0) {
+        out->sink(out->ctx, out->buf, out->len);
+        out->len = 0;
+    }
+}
+
+static void out_write(struct printf_out *out, const char *data, size_t len)
+{
+    out->total += len;
+
+    while (len > 0) {
+        size_t room = out->size - out->len;
+        if (room == 0) {
+            if (out->sink == NULL) {
+                return;
+            }
+            out_flush(out);
+            room = out->size;
+        }
+
+        size_t chunk = (len < room) ? len : room;
+        for (size_t i = 0; i < chunk; i++) {
+            out->buf[out->len + i] = data[i];
+        }
+        out->len += chunk;
+        data += chunk;
+        len -= chunk;
+    }
+}
+
+static void out_repeat(struct printf_out *out, char c, int count)
+{
+    char pad[16];
+    for (int i = 0; i < 16; i++) {
+        pad[i] = c;
+    }
+    while (count > 0) {
+        int chunk = (count < 16) ? count : 16;
+        out_write(out, pad, chunk);
+        count -= chunk;
+    }
+}
+
+/*
+ * Write value in decimal, right-aligned so that it ends just before
+ * end. Returns the first digit.
+ */
+static char *format_dec32(uint32_t value, char *end)
+{
+    while (value >= 100) {
+        uint32_t pair = (value % 100) * 2;
+        value /= 100;
+        *--end = digit_pairs[pair + 1];
+        *--end = digit_pairs[pair];
+    }
+    if (value >= 10) {
+        *--end = digit_pairs[value * 2 + 1];
+        *--end = digit_pairs[value * 2];
+    } else {
+        *--end = (char)('0' + value);
+    }
+    return end;
+}
+
+/*
+ * Divide *value by 10^9 in place, returning the remainder
+ */
+static uint32_t div_billion(uint64_t *value)
+{
+    const uint32_t billion = 1000000000;
+    uint32_t high = (uint32_t)(*value >> 32);
+    uint32_t low = (uint32_t)*value;
+    uint32_t quot_high = high / billion;
+    uint32_t rem;
+
+    /* (high % billion) < billion, so the 64/32 divide can't overflow */
+    uint32_t quot_low = div64_32(((uint64_t)(high % billion) << 32) | low, billion, &rem);
+
+    *value = ((uint64_t)quot_high << 32) | quot_low;
+    return rem;
+}
+
+static char *format_dec64(uint64_t value, char *end)
+{
+    while (value >> 32) {
+        /* Lower chunks always have all nine digits */
+        char *chunk_end = end;
+        end = format_dec32(div_billion(&value), end);
+        while (end > chunk_end - 9) {
+            *--end = '0';
+        }
+    }
+    return format_dec32((uint32_t)value, end);
+}
+
+static char *format_base(uint64_t value, int shift, const char *digits, char *end)
+{
+    uint32_t mask = (1u << shift) - 1;
+    do {
+        *--end = digits[(uint32_t)value & mask];
+        value >>= shift;
+    } while (value != 0);
+    return end;
+}
+
+/*
+ * Emit one numeric conversion with sign/prefix, precision and padding
+ */
+static void format_number(struct printf_out *out, uint64_t value, bool negative,
+                          char conv, int flags, int width, int precision)
+{
+    char buffer[NUM_BUFFER_SIZE];
+    char *end = buffer + sizeof(buffer);
+    char *digits;
+    const char *prefix = "";
+
+    switch (conv) {
+    case 'x':
+    case 'p':
+        digits = format_base(value, 4, hex_lower, end);
+        if ((flags & FLAG_ALT) && value != 0) {
+            prefix = "0x";
+        }
+        break;
+    case 'X':
+        digits = format_base(value, 4, hex_upper, end);
+        if ((flags & FLAG_ALT) && value != 0) {
+            prefix = "0X";
+        }
+        break;
+    case 'o':
+        digits = format_base(value, 3, hex_lower, end);
+        if ((flags & FLAG_ALT) && value != 0) {
+            prefix = "0";
+        }
+        break;
+    default:
+        digits = (value >> 32) ? format_dec64(value, end) : format_dec32((uint32_t)value, end);
+        if (negative) {
+            prefix = "-";
+        } else if (flags & FLAG_PLUS) {
+            prefix = "+";
+        } else if (flags & FLAG_SPACE) {
+            prefix = " ";
+        }
+        break;
+    }
+
+    int num_digits = end - digits;
+    if (precision == 0 && value == 0) {
+        num_digits = 0;     /* "%.0d" of zero prints nothing */
+    }
+
+    int zeros = (precision > num_digits) ? precision - num_digits : 0;
+    int prefix_len = strlen(prefix);
+    int pad = width - prefix_len - zeros - num_digits;
+
+    /* The 0 flag pads with zeros after the sign, unless a precision is given */
+    if ((flags & FLAG_ZERO) && !(flags & FLAG_LEFT) && precision < 0 && pad > 0) {
+        zeros += pad;
+        pad = 0;
+    }
+
+    if (!(flags & FLAG_LEFT)) {
+        out_repeat(out, ' ', pad);
+    }
+    out_write(out, prefix, prefix_len);
+    out_repeat(out, '0', zeros);
+    out_write(out, digits, num_digits);
+    if (flags & FLAG_LEFT) {
+        out_repeat(out, ' ', pad);
+    }
+}
+
+/*
+ * Emit a string conversion (at most precision bytes, if >= 0)
+ */
+static void format_string(struct printf_out *out, const char *str, int flags, int width, int precision)
+{
+    if (str == NULL) {
+        str = "(null)";
+    }
+
+    int len = 0;
+    while ((precision < 0 || len < precision) && str[len] != '\0') {
+        len++;
+    }
+
+    int pad = width - len;
+    if (!(flags & FLAG_LEFT)) {
+        out_repeat(out, ' ', pad);
+    }
+    out_write(out, str, len);
+    if (flags & FLAG_LEFT) {
+        out_repeat(out, ' ', pad);
+    }
+}
+
+/*
+ * The formatter
+ */
+static void format(struct printf_out *out, const char *fmt, va_list args)
+{
+    while (*fmt) {
+        /* Copy literal text up to the next conversion in one go */
+        const char *start = fmt;
+        while (*fmt && *fmt != '%') {
+            fmt++;
+        }
+        out_write(out, start, fmt - start);
+        if (!*fmt) {
+            break;
+        }
+        fmt++;
+
+        /* Flags */
+        int flags = 0;
+        for (;; fmt++) {
+            if (*fmt == '-') flags |= FLAG_LEFT;
+            else if (*fmt == '0') flags |= FLAG_ZERO;
+            else if (*fmt == '+') flags |= FLAG_PLUS;
+            else if (*fmt == ' ') flags |= FLAG_SPACE;
+            else if (*fmt == '#') flags |= FLAG_ALT;
+            else break;
+        }
+
+        /* Width */
+        int width = 0;
+        if (*fmt == '*') {
+            width = va_arg(args, int);
+            if (width < 0) {
+                flags |= FLAG_LEFT;
+                width = -width;
+            }
+            fmt++;
+        } else {
+            while (*fmt >= '0' && *fmt <= '9') {
+                width = width * 10 + (*fmt++ - '0');
+            }
+        }
+
+        /* Precision */
+        int precision = -1;
+        if (*fmt == '.') {
+            fmt++;
+            precision = 0;
+            if (*fmt == '*') {
+                precision = va_arg(args, int);
+                fmt++;
+            } else {
+                while (*fmt >= '0' && *fmt <= '9') {
+                    precision = precision * 10 + (*fmt++ - '0');
+                }
+            }
+        }
+
+        /* Length: ll and j widen the argument, h and hh narrow the value */
+        int length = LENGTH_INT;
+        while (*fmt == 'h' || *fmt == 'l' || *fmt == 'z' || *fmt == 't' || *fmt == 'j') {
+            if (*fmt == 'l' && fmt[1] == 'l') {
+                length = LENGTH_64;
+                fmt++;
+            } else if (*fmt == 'j') {
+                length = LENGTH_64;
+            } else if (*fmt == 'h' && fmt[1] == 'h') {
+                length = LENGTH_CHAR;
+                fmt++;
+            } else if (*fmt == 'h') {
+                length = LENGTH_SHORT;
+            }
+            fmt++;
+        }
+
+        char conv = *fmt;
+        if (conv == '\0') {
+            break;
+        }
+        fmt++;
+
+        switch (conv) {
+        case 'd':
+        case 'i': {
+            int64_t value;
+            if (length == LENGTH_64) {
+                value = va_arg(args, int64_t);
+            } else {
+                value = va_arg(args, int32_t);
+                if (length == LENGTH_CHAR) {
+                    value = (int8_t)value;
+                } else if (length == LENGTH_SHORT) {
+                    value = (int16_t)value;
+                }
+            }
+            bool negative = value < 0;
+            uint64_t magnitude = negative ? (uint64_t)0 - (uint64_t)value : (uint64_t)value;
+            format_number(out, magnitude, negative, conv, flags, width, precision);
+            break;
+        }
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'o': {
+            uint64_t value;
+            if (length == LENGTH_64) {
+                value = va_arg(args, uint64_t);
+            } else {
+                value = va_arg(args, uint32_t);
+                if (length == LENGTH_CHAR) {
+                    value = (uint8_t)value;
+                } else if (length == LENGTH_SHORT) {
+                    value = (uint16_t)value;
+                }
+            }
+            format_number(out, value, false, conv, flags, width, precision);
+            break;
+        }
+        case 'p':
+            format_number(out, (uintptr_t)va_arg(args, void *), false, 'p',
+                          flags | FLAG_ALT, width, precision);
+            break;
+        case 's':
+            format_string(out, va_arg(args, const char *), flags, width, precision);
+            break;
+        case 'c': {
+            char c = (char)va_arg(args, int);
+            int pad = width - 1;
+            if (!(flags & FLAG_LEFT)) {
+                out_repeat(out, ' ', pad);
+            }
+            out_write(out, &c, 1);
+            if (flags & FLAG_LEFT) {
+                out_repeat(out, ' ', pad);
+            }
+            break;
+        }
+        case '%':
+            out_write(out, "%", 1);
+            break;
+        default:
+            /* Unknown conversion: print it as it was written */
+            out_write(out, "%", 1);
+            out_write(out, &conv, 1);
+            break;
+        }
+    }
+}
+
+/*
+ * Sinks
+ */
+void printf_sink_console(void *ctx, const char *data, size_t len)
+{
+    (void)ctx;
+    vga_write(data, len);
+}
+
+void printf_sink_serial(void *ctx, const char *data, size_t len)
+{
+    (void)ctx;
+    serial_write(data, len);
+}
+
+/*
+ * Entry points
+ */
+int kvfprintf(printf_sink_t sink, void *ctx, const char *fmt, va_list args)
+{
+    char buffer[PRINTF_BUFFER_SIZE];
+    struct printf_out out = { buffer, sizeof(buffer), 0, 0, sink, ctx };
+
+    format(&out, fmt, args);
+    out_flush(&out);
+    return (int)out.total;
+}
+
+int kfprintf(printf_sink_t sink, void *ctx, const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    int result = kvfprintf(sink, ctx, fmt, args);
+    va_end(args);
+    return result;
+}
+
+int kvprintf(const char *fmt, va_list args)
+{
+    return kvfprintf(printf_sink_console, NULL, fmt, args);
+}
+
+int kprintf(const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    int result = kvfprintf(printf_sink_console, NULL, fmt, args);
+    va_end(args);
+    return result;
+}
+
+int kvsnprintf(char *buf, size_t size, const char *fmt, va_list args)
+{
+    /* Keep the last byte for the terminator */
+    struct printf_out out = { buf, (size > 0) ? size - 1 : 0, 0, 0, NULL, NULL };
+
+    format(&out, fmt, args);
+    if (size > 0) {
+        buf[out.len] = '\0';
+    }
+    return (int)out.total;
+}
+
+int ksnprintf(char *buf, size_t size, const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    int result = kvsnprintf(buf, size, fmt, args);
+    va_end(args);
+    return result;
+}
@@ -0,0 +1,43 @@
+/*
+ * KontolOS Formatted Output Header
+ *
+ * printf-style formatting into a buffer that is handed to a sink in
+ * whole chunks (normally once per call). Supported conversions:
+ * %d %i %u %x %X %o %p %s %c %%, with the flags - 0 + space #, a width
+ * and precision (either may be *), and the length modifiers hh h l ll z.
+ */
+
+#ifndef PRINTF_H
+#define PRINTF_H
+
+#include "../include/types.h"
+
+/* Let the compiler check arguments against the format string */
+#define PRINTF_FORMAT(fmt, args) __attribute__((format(printf, fmt, args)))
+
+/* Receives formatted text, len bytes at a time (not NUL-terminated) */
+typedef void (*printf_sink_t)(void *ctx, const char *data, size_t len);
+
+/* Bytes buffered before a sink is called */
+#define PRINTF_BUFFER_SIZE  256
+
+/* Built-in sinks (ctx unused) */
+void printf_sink_console(void *ctx, const char *data, size_t len);
+void printf_sink_serial(void *ctx, const char *data, size_t len);
+
+/* Print to the console; return the number of characters written */
+int kprintf(const char *fmt, ...) PRINTF_FORMAT(1, 2);
+int kvprintf(const char *fmt, va_list args);
+
+/* Print to any sink */
+int kfprintf(printf_sink_t sink, void *ctx, const char *fmt, ...) PRINTF_FORMAT(3, 4);
+int kvfprintf(printf_sink_t sink, void *ctx, const char *fmt, va_list args);
+
+/*
+ * Format into buf (always NUL-terminated when size > 0). Returns the
+ * length the full output would have had, like snprintf.
+ */
+int ksnprintf(char *buf, size_t size, const char *fmt, ...) PRINTF_FORMAT(3, 4);
+int kvsnprintf(char *buf, size_t size, const char *fmt, va_list args);
+
+#endif /* PRINTF_H */
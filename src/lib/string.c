@@ -4,16 +4,56 @@
 
 #include "string.h"
 
+/*
+ * Word-at-a-time helpers
+ *
+ * strlen and friends look at four bytes per step. A word has a zero
+ * byte exactly when (w - 0x01010101) & ~w & 0x80808080 is non-zero,
+ * and a byte equal to c when the same test finds a zero in w ^ (c *
+ * 0x01010101). Aligned loads never cross a page boundary, so reading
+ * past the terminator within the last word can't fault. Loads that
+ * cannot be aligned (the second string of strcmp) are done one byte at
+ * a time whenever a word would straddle a page.
+ */
+#define ONES            0x01010101u
+#define HIGHS           0x80808080u
+#define HAS_ZERO(w)     (((w) - ONES) & ~(w) & HIGHS)
+#define WORD_MASK       (sizeof(uint32_t) - 1)
+#define PAGE_MASK       0xFFFu
+
+typedef uint32_t __attribute__((may_alias)) word_t;
+typedef uint32_t __attribute__((may_alias, aligned(1))) uword_t;
+
+/* Can a 4-byte load at p be done without touching the next page? */
+static inline int word_in_page(const void *p)
+{
+    return ((uintptr_t)p & PAGE_MASK) <= PAGE_MASK - WORD_MASK;
+}
+
 /*
  * Get string length
  */
 size_t strlen(const char *s)
 {
-    size_t len = 0;
-    while (s[len]) {
-        len++;
+    const char *p = s;
+
+    while ((uintptr_t)p & WORD_MASK) {
+        if (!*p) {
+            return p - s;
+        }
+        p++;
+    }
+
+    const word_t *w = (const word_t *)p;
+    while (!HAS_ZERO(*w)) {
+        w++;
     }
-    return len;
+
+    p = (const char *)w;
+    while (*p) {
+        p++;
+    }
+    return p - s;
 }
 
 /*
@@ -21,11 +61,34 @@ size_t strlen(const char *s)
  */
 int strcmp(const char *s1, const char *s2)
 {
-    while (*s1 && (*s1 == *s2)) {
+    /* Align s1; s2 is loaded unaligned */
+    while ((uintptr_t)s1 & WORD_MASK) {
+        if (!*s1 || *s1 != *s2) {
+            return *(unsigned char *)s1 - *(unsigned char *)s2;
+        }
         s1++;
         s2++;
     }
-    return *(unsigned char *)s1 - *(unsigned char *)s2;
+
+    for (;;) {
+        if (word_in_page(s2)) {
+            uint32_t w = *(const word_t *)s1;
+            if (w == *(const uword_t *)s2 && !HAS_ZERO(w)) {
+                s1 += 4;
+                s2 += 4;
+                continue;
+            }
+        }
+
+        /* Difference, terminator or page edge somewhere in these 4 bytes */
+        for (int i = 0; i < 4; i++) {
+            if (!*s1 || *s1 != *s2) {
+                return *(unsigned char *)s1 - *(unsigned char *)s2;
+            }
+            s1++;
+            s2++;
+        }
+    }
 }
 
 /*
@@ -33,6 +96,25 @@ int strcmp(const char *s1, const char *s2)
  */
 int strncmp(const char *s1, const char *s2, size_t n)
 {
+    while (n && ((uintptr_t)s1 & WORD_MASK)) {
+        if (!*s1 || *s1 != *s2) {
+            return *(unsigned char *)s1 - *(unsigned char *)s2;
+        }
+        s1++;
+        s2++;
+        n--;
+    }
+
+    while (n >= 4 && word_in_page(s2)) {
+        uint32_t w = *(const word_t *)s1;
+        if (w != *(const uword_t *)s2 || HAS_ZERO(w)) {
+            break;
+        }
+        s1 += 4;
+        s2 += 4;
+        n -= 4;
+    }
+
     while (n && *s1 && (*s1 == *s2)) {
         s1++;
         s2++;
@@ -50,6 +132,21 @@ int strncmp(const char *s1, const char *s2, size_t n)
 char *strcpy(char *dest, const char *src)
 {
     char *d = dest;
+
+    /* Align the source; the destination may be stored unaligned */
+    while ((uintptr_t)src & WORD_MASK) {
+        if (!(*d++ = *src++)) {
+            return dest;
+        }
+    }
+
+    const word_t *w = (const word_t *)src;
+    while (!HAS_ZERO(*w)) {
+        *(uword_t *)d = *w++;
+        d += 4;
+    }
+
+    src = (const char *)w;
     while ((*d++ = *src++));
     return dest;
 }
@@ -74,11 +171,7 @@ char *strncpy(char *dest, const char *src, size_t n)
  */
 char *strcat(char *dest, const char *src)
 {
-    char *d = dest;
-    while (*d) {
-        d++;
-    }
-    while ((*d++ = *src++));
+    strcpy(dest + strlen(dest), src);
     return dest;
 }
 
@@ -87,13 +180,33 @@ char *strcat(char *dest, const char *src)
  */
 char *strchr(const char *s, int c)
 {
+    char ch = (char)c;
+
+    while ((uintptr_t)s & WORD_MASK) {
+        if (*s == ch) {
+            return (char *)s;
+        }
+        if (!*s) {
+            return NULL;
+        }
+        s++;
+    }
+
+    /* Stop at the word holding either c or the terminator */
+    uint32_t pattern = (uint8_t)ch * ONES;
+    const word_t *w = (const word_t *)s;
+    while (!HAS_ZERO(*w) && !HAS_ZERO(*w ^ pattern)) {
+        w++;
+    }
+
+    s = (const char *)w;
     while (*s) {
-        if (*s == (char)c) {
+        if (*s == ch) {
             return (char *)s;
         }
         s++;
     }
-    return (c == 0) ? (char *)s : NULL;
+    return (ch == 0) ? (char *)s : NULL;
 }
 
 /*
@@ -112,33 +225,117 @@ char *strrchr(const char *s, int c)
 }
 
 /*
- * Find substring in string
+ * Find a byte in a memory block
  */
-char *strstr(const char *haystack, const char *needle)
+void *memchr(const void *s, int c, size_t n)
 {
-    if (!*needle) {
-        return (char *)haystack;
+    const uint8_t *p = s;
+    uint8_t ch = (uint8_t)c;
+
+    while (n && ((uintptr_t)p & WORD_MASK)) {
+        if (*p == ch) {
+            return (void *)p;
+        }
+        p++;
+        n--;
     }
 
-    while (*haystack) {
-        const char *h = haystack;
-        const char *n = needle;
+    /* Skip whole words that don't contain c */
+    uint32_t pattern = ch * ONES;
+    while (n >= 4 && !HAS_ZERO(*(const word_t *)p ^ pattern)) {
+        p += 4;
+        n -= 4;
+    }
 
-        while (*h && *n && (*h == *n)) {
-            h++;
-            n++;
+    while (n) {
+        if (*p == ch) {
+            return (void *)p;
         }
+        p++;
+        n--;
+    }
+    return NULL;
+}
 
-        if (!*n) {
-            return (char *)haystack;
+/*
+ * Compare the first n bytes of a and b for equality
+ */
+static inline int bytes_equal(const uint8_t *a, const uint8_t *b, size_t n)
+{
+    while (n && *a == *b) {
+        a++;
+        b++;
+        n--;
+    }
+    return n == 0;
+}
+
+/*
+ * Find a byte sequence in a memory block
+ *
+ * Needles shorter than MEMMEM_SHORT are found by jumping between
+ * occurrences of their first byte with memchr. Longer ones use
+ * Boyer-Moore-Horspool: after a mismatch the window moves by the
+ * distance from the byte under its last position to that byte's last
+ * occurrence in the needle, so most of the haystack is never looked at.
+ */
+#define MEMMEM_SHORT    4
+
+void *memmem(const void *haystack, size_t haystack_len, const void *needle, size_t needle_len)
+{
+    const uint8_t *h = haystack;
+    const uint8_t *n = needle;
+
+    if (needle_len == 0) {
+        return (void *)h;
+    }
+    if (needle_len > haystack_len) {
+        return NULL;
+    }
+
+    const uint8_t *last = h + (haystack_len - needle_len);
+
+    if (needle_len < MEMMEM_SHORT) {
+        while (h <= last) {
+            h = memchr(h, n[0], (size_t)(last - h) + 1);
+            if (h == NULL) {
+                return NULL;
+            }
+            if (bytes_equal(h + 1, n + 1, needle_len - 1)) {
+                return (void *)h;
+            }
+            h++;
         }
+        return NULL;
+    }
 
-        haystack++;
+    size_t skip[256];
+    for (int i = 0; i < 256; i++) {
+        skip[i] = needle_len;
+    }
+    for (size_t i = 0; i < needle_len - 1; i++) {
+        skip[n[i]] = needle_len - 1 - i;
     }
 
+    uint8_t tail = n[needle_len - 1];
+    while (h <= last) {
+        uint8_t c = h[needle_len - 1];
+        if (c == tail && bytes_equal(h, n, needle_len - 1)) {
+            return (void *)h;
+        }
+        h += skip[c];
+    }
     return NULL;
 }
 
+/*
+ * Find substring in string
+ */
+char *strstr(const char *haystack, const char *needle)
+{
+    return memmem(haystack, strlen(haystack), needle, strlen(needle));
+}
+
 /*
  * Convert integer to string
  */
@@ -18,6 +18,10 @@ char *strchr(const char *s, int c);
 char *strrchr(const char *s, int c);
 char *strstr(const char *haystack, const char *needle);
 
+/* Memory search functions */
+void *memchr(const void *s, int c, size_t n);
+void *memmem(const void *haystack, size_t haystack_len, const void *needle, size_t needle_len);
+
 /* Conversion functions */
 char *itoa(int value, char *str, int base);
 int atoi(const char *str);